@@ -130,28 +130,63 @@ direction_t pin_direction(const position_t* pos,
  */
 bool is_square_attacked(const position_t* pos, square_t sq, color_t side)
 {
-    // For every opposing piece, look up the attack data for its square.
-    // Special-case pawns for efficiency.
-    piece_t opp_pawn = create_piece(side, PAWN);
-    if (pos->board[sq - piece_deltas[opp_pawn][0]] == opp_pawn) return true;
-    if (pos->board[sq - piece_deltas[opp_pawn][1]] == opp_pawn) return true;
-
-    square_t from;
-    for (const square_t* pfrom = &pos->pieces[side][0];
-            (from = *pfrom) != INVALID_SQUARE;
-            ++pfrom) {
-        piece_t p = pos->board[from];
-        if (possible_attack(from, sq, p)) {
-            if (piece_slide_type(p) == NO_SLIDE) return true;
-            direction_t att_dir = direction(from, sq);
-            while (from != sq) {
-                from += att_dir;
-                if (from == sq) return true;
-                if (pos->board[from] != EMPTY) break;
-            }
-        }
+    int ind = square_to_index(sq);
+    bitboard_t occupied = occupied_squares(pos);
+    const bitboard_t* bb = &pos->piece_bb[create_piece(side, NONE)];
+    if ((pawn_attacks[side^1][ind] & bb[PAWN]) ||
+            (knight_attacks[ind] & bb[KNIGHT]) ||
+            (king_attacks[ind] & bb[KING])) return true;
+    // Only look up slider attacks if there's a slider on one of our lines.
+    bitboard_t diagonal = (bb[BISHOP] | bb[QUEEN]) & bishop_attacks(ind, 0);
+    bitboard_t straight = (bb[ROOK] | bb[QUEEN]) & rook_attacks(ind, 0);
+    return (diagonal && (bishop_attacks(ind, occupied) & diagonal)) ||
+        (straight && (rook_attacks(ind, occupied) & straight));
+}
+
+/*
+ * Find all pieces of either side that attack the square with index |ind|,
+ * treating |occupied| as the set of occupied squares.
+ */
+bitboard_t attackers_to(const position_t* pos, int ind, bitboard_t occupied)
+{
+    return (pawn_attacks[BLACK][ind] & pos->piece_bb[WP]) |
+        (pawn_attacks[WHITE][ind] & pos->piece_bb[BP]) |
+        (knight_attacks[ind] & (pos->piece_bb[WN] | pos->piece_bb[BN])) |
+        (king_attacks[ind] & (pos->piece_bb[WK] | pos->piece_bb[BK])) |
+        (bishop_attacks(ind, occupied) &
+         (pos->piece_bb[WB] | pos->piece_bb[BB] |
+          pos->piece_bb[WQ] | pos->piece_bb[BQ])) |
+        (rook_attacks(ind, occupied) &
+         (pos->piece_bb[WR] | pos->piece_bb[BR] |
+          pos->piece_bb[WQ] | pos->piece_bb[BQ]));
+}
+
+/*
+ * Find the pieces of color |side| that are the only piece standing between
+ * the |king_side| king and an enemy slider aimed at it. For our own king
+ * these are the pinned pieces; for the opponent's king they're the pieces
+ * that can give discovered check.
+ */
+bitboard_t king_blockers(const position_t* pos,
+        color_t king_side,
+        color_t side)
+{
+    int king_ind = square_to_index(pos->pieces[king_side][0]);
+    bitboard_t occupied = occupied_squares(pos);
+    color_t attacker = flip_color(king_side);
+    bitboard_t queens = pos->piece_bb[create_piece(attacker, QUEEN)];
+    bitboard_t snipers =
+        (bishop_attacks(king_ind, EMPTY_BB) &
+         (pos->piece_bb[create_piece(attacker, BISHOP)] | queens)) |
+        (rook_attacks(king_ind, EMPTY_BB) &
+         (pos->piece_bb[create_piece(attacker, ROOK)] | queens));
+    bitboard_t blockers = EMPTY_BB;
+    for (; snipers; snipers &= snipers - 1) {
+        bitboard_t between =
+            between_mask[king_ind][first_bit(snipers)] & occupied;
+        if (between && !(between & (between - 1))) blockers |= between;
     }
-    return false;
+    return blockers & pos->color_bb[side];
 }
 
 /*
@@ -179,6 +214,33 @@ bool piece_attacks_near(const position_t* pos, square_t from, square_t target)
     return false;
 }
 
+/*
+ * Fill |ci| with the checks and pins in |pos|, from the point of view of the
+ * side to move.
+ */
+void init_check_info(const position_t* pos, check_info_t* ci)
+{
+    color_t side = pos->side_to_move;
+    color_t other_side = flip_color(side);
+    bitboard_t occupied = occupied_squares(pos);
+    ci->king_ind = square_to_index(pos->pieces[side][0]);
+    ci->their_king_ind = square_to_index(pos->pieces[other_side][0]);
+    ci->checkers = is_check(pos) ?
+        attackers_to(pos, ci->king_ind, occupied) &
+        pos->color_bb[other_side] : EMPTY_BB;
+    ci->pinned = king_blockers(pos, side, side);
+    ci->discoverers = king_blockers(pos, other_side, side);
+
+    int ind = ci->their_king_ind;
+    ci->check_squares[NONE] = ci->check_squares[KING] = EMPTY_BB;
+    ci->check_squares[PAWN] = pawn_attacks[other_side][ind];
+    ci->check_squares[KNIGHT] = knight_attacks[ind];
+    ci->check_squares[BISHOP] = bishop_attacks(ind, occupied);
+    ci->check_squares[ROOK] = rook_attacks(ind, occupied);
+    ci->check_squares[QUEEN] =
+        ci->check_squares[BISHOP] | ci->check_squares[ROOK];
+}
+
 /*
  * Set |pos->check_square| to the location of a checking piece, and return 0
  * if |pos| is not check, 1 if there is exactly 1 checker, or 2 if there are
@@ -186,46 +248,74 @@ bool piece_attacks_near(const position_t* pos, square_t from, square_t target)
  */
 uint8_t find_checks(position_t* pos)
 {
-    // For every opposing piece, look up the attack data for its square.
-    uint8_t attackers = 0;
-    pos->check_square = EMPTY;
-    color_t side = flip_color(pos->side_to_move);
-    square_t sq = pos->pieces[side^1][0];
+    color_t side = pos->side_to_move;
+    bitboard_t checkers = attackers_to(pos,
+            square_to_index(pos->pieces[side][0]),
+            occupied_squares(pos)) & pos->color_bb[side^1];
+    if (!checkers) {
+        pos->check_square = EMPTY;
+        return 0;
+    }
+    pos->check_square = index_to_square(first_bit(checkers));
+    return (checkers & (checkers - 1)) ? 2 : 1;
+}
 
-    // Special-case pawns for efficiency.
-    piece_t opp_pawn = create_piece(side, PAWN);
-    if (pos->board[sq - piece_deltas[opp_pawn][0]] == opp_pawn) {
-        pos->check_square = sq - piece_deltas[opp_pawn][0];
-        if (++attackers > 1) return attackers;
+/*
+ * Find the sliders of color |side| that check the king on |king_sq| through
+ * |sq|, if |sq| has just been vacated and nothing now stands between it and
+ * the king.
+ */
+static bitboard_t discovered_checkers(const position_t* pos,
+        color_t side,
+        square_t king_sq,
+        square_t sq,
+        bitboard_t occupied)
+{
+    if (!possible_attack(sq, king_sq, WQ) ||
+            (squares_between(sq, king_sq) & occupied)) return EMPTY_BB;
+    const bitboard_t* bb = &pos->piece_bb[create_piece(side, NONE)];
+    int king_ind = square_to_index(king_sq);
+    if (possible_attack(sq, king_sq, WB)) {
+        return bishop_attacks(king_ind, occupied) & (bb[BISHOP] | bb[QUEEN]);
     }
-    if (pos->board[sq - piece_deltas[opp_pawn][1]] == opp_pawn) {
-        pos->check_square = sq - piece_deltas[opp_pawn][1];
-        if (++attackers > 1) return attackers;
+    return rook_attacks(king_ind, occupied) & (bb[ROOK] | bb[QUEEN]);
+}
+
+/*
+ * Like |find_checks|, but for a position where |move| has just been made.
+ * Since the side that moved couldn't have been giving check beforehand, the
+ * only possible checkers are the piece that moved, or the rook for castling
+ * moves, and sliders behind a square that the move vacated.
+ */
+uint8_t find_move_checks(position_t* pos, move_t move)
+{
+    color_t side = flip_color(pos->side_to_move);
+    square_t king_sq = pos->pieces[side^1][0];
+    bitboard_t occupied = occupied_squares(pos);
+    square_t to = get_move_to(move);
+    bitboard_t checkers = discovered_checkers(pos, side, king_sq,
+            get_move_from(move), occupied);
+    if (is_move_castle(move)) {
+        bool short_castle = is_move_castle_short(move);
+        checkers |= discovered_checkers(pos, side, king_sq, short_castle ?
+                king_rook_home + A8*side : queen_rook_home + A8*side,
+                occupied);
+        to = short_castle ? F1 + A8*side : D1 + A8*side;
+    } else if (is_move_enpassant(move)) {
+        checkers |= discovered_checkers(pos, side, king_sq,
+                to - pawn_push[side], occupied);
+    }
+    piece_t piece = pos->board[to];
+    if (possible_attack(to, king_sq, piece) &&
+            (piece_slide_type(piece) == NO_SLIDE ||
+             !(squares_between(to, king_sq) & occupied))) {
+        set_sq_bit(checkers, to);
     }
 
-    square_t from;
-    for (square_t* pfrom = &pos->pieces[side][1];
-            (from = *pfrom) != INVALID_SQUARE;
-            ++pfrom) {
-        piece_t p = pos->board[from];
-        if (possible_attack(from, sq, p)) {
-            if (piece_slide_type(p) == NO_SLIDE) {
-                pos->check_square = from;
-                if (++attackers > 1) return attackers;
-                continue;
-            }
-            square_t att_sq = from;
-            direction_t att_dir = direction(from, sq);
-            while (att_sq != sq) {
-                att_sq += att_dir;
-                if (att_sq == sq) {
-                    pos->check_square = from;
-                    if (++attackers > 1) return attackers;
-                }
-                if (pos->board[att_sq]) break;
-            }
-        }
+    if (!checkers) {
+        pos->check_square = EMPTY;
+        return 0;
     }
-    return attackers;
+    pos->check_square = index_to_square(first_bit(checkers));
+    return (checkers & (checkers - 1)) ? 2 : 1;
 }
-
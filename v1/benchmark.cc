@@ -45,8 +45,9 @@ void benchmark(int depth, int time_limit)
         deepening_search(&root_data, false);
         time = stop_timer(&bench_timer);
         printf("time: %d\ndepth: %d\nnodes: %"PRIu64"\n",
-                time, (int)root_data.current_depth, root_data.nodes_searched);
-        total_nodes += root_data.nodes_searched;
+                time, (int)root_data.current_depth,
+                total_nodes_searched(&root_data));
+        total_nodes += total_nodes_searched(&root_data);
     }
     time = elapsed_time(&bench_timer);
     printf("aggregate nodes %"PRIu64" time %d nps %"PRIu64"\n",
@@ -18,6 +18,15 @@ bitboard_t clear_mask[64];
 bitboard_t in_front_mask[2][64];
 bitboard_t outpost_mask[2][64];
 bitboard_t passed_mask[2][64];
+bitboard_t between_mask[64][64];
+bitboard_t line_mask[64][64];
+bitboard_t knight_attacks[64];
+bitboard_t king_attacks[64];
+bitboard_t pawn_attacks[2][64];
+magic_t bishop_magics[64];
+magic_t rook_magics[64];
+static bitboard_t bishop_attack_table[0x1480];
+static bitboard_t rook_attack_table[0x19000];
 const int bit_table[64] = {
      0,  1,  2,  7,  3, 13,  8, 19,
      4, 25, 14, 28,  9, 34, 20, 40,
@@ -29,6 +38,114 @@ const int bit_table[64] = {
     61, 22, 43, 51, 60, 42, 59, 58
 };
 
+#ifndef USE_PEXT
+// Magic multipliers for each square, found by trial and error. Each maps
+// every relevant occupancy of the slider's rays to a distinct table entry,
+// or to an entry with the same attacks.
+static const bitboard_t bishop_magic_numbers[64] = {
+    0x10102002004a1420ull, 0x8020040400584008ull, 0x10510800811201c8ull,
+    0x5204042080000088ull, 0x2204106880000002ull, 0x1401042004000000ull,
+    0x0400880410042004ull, 0x0028208200a02020ull, 0x1500241990010e00ull,
+    0x8001200182020a40ull, 0x40004101030b0000ull, 0x8002041042000100ull,
+    0x4010011041020038ull, 0x0000010421044000ull, 0x1500210808020a00ull,
+    0x8000088400880520ull, 0x0405004010040100ull, 0x1005823210040108ull,
+    0x2708008102040011ull, 0x4048200404009100ull, 0x0018104101400024ull,
+    0x0003000601190101ull, 0x8004803108491000ull, 0x8014241200820800ull,
+    0x0006e080100c3040ull, 0x0501044a11041800ull, 0x9020300008004045ull,
+    0x0894080000220040ull, 0x1001010083104000ull, 0x5004030040900080ull,
+    0x000400422c012400ull, 0x0002128698404812ull, 0x1010108404900440ull,
+    0x0928021182084100ull, 0x2006080409020024ull, 0x1010202020180080ull,
+    0xa010008200202200ull, 0x2098015100019004ull, 0x0002041440810811ull,
+    0x802a02020000b098ull, 0x0009015090004060ull, 0x4000821082081001ull,
+    0x0100210040420800ull, 0x0800004010488a00ull, 0x2000081104004040ull,
+    0x4c8e029015000082ull, 0x0420340322224842ull, 0x1298260043400210ull,
+    0x0000822802400008ull, 0x00008a0101600000ull, 0x3040003412080021ull,
+    0x3040290220884800ull, 0x4a1500401041004aull, 0x8010200282020781ull,
+    0x0020203142209091ull, 0x0070300600902110ull, 0x0040808800b62048ull,
+    0x0000810400c44420ull, 0x00080400440c0441ull, 0x8340080020840411ull,
+    0x0000000104208200ull, 0x0000800810d00080ull, 0x0400530411080200ull,
+    0x4040702400932244ull
+};
+static const bitboard_t rook_magic_numbers[64] = {
+    0x1080004008801020ull, 0x0840092002c03000ull, 0x1900200010400900ull,
+    0x0880100008000480ull, 0x4200100420080200ull, 0x8100020100080400ull,
+    0x0200040110886200ull, 0x0200008040220411ull, 0x0404800084400220ull,
+    0x0000401000402000ull, 0x0086001081220440ull, 0x0408800800100280ull,
+    0x000a001201040820ull, 0x8848800200840080ull, 0x4001000100040200ull,
+    0x0442000102105084ull, 0x9080010020804100ull, 0x0040404000201009ull,
+    0x0000808010002009ull, 0x2200090021d00100ull, 0x0008008008040080ull,
+    0x0004004002010040ull, 0x0011040008015042ull, 0x00000a0001768104ull,
+    0x0000800080204009ull, 0x2010004140002001ull, 0x9800200280100080ull,
+    0x1000100080080080ull, 0x0442000a00049020ull, 0x2100040080020080ull,
+    0x0800120400900148ull, 0x0010040a00128541ull, 0x2800804000800030ull,
+    0x1010002000400041ull, 0x4000200011004100ull, 0x0610008410800800ull,
+    0x0400802402800800ull, 0xc100020080800400ull, 0x0002000802000401ull,
+    0x0182085882000401ull, 0x0220204000808000ull, 0x2860100040024022ull,
+    0x0001002004110040ull, 0x99101042000a0020ull, 0x0004080004008080ull,
+    0x0010040002008080ull, 0x2012004881020004ull, 0x8300842444820011ull,
+    0x0088403882010200ull, 0x0820400080210100ull, 0x0110910040a00300ull,
+    0x0801100280080480ull, 0x0242009008200600ull, 0x1002000489500200ull,
+    0x0040800200010080ull, 0x0091800041000080ull, 0x0000209300488001ull,
+    0x04c1002414824001ull, 0x020020000b001041ull, 0x7000100004200901ull,
+    0x8002002004100802ull, 0x30010002084c0007ull, 0x0888221800813004ull,
+    0x4000002840840112ull
+};
+#endif
+
+/*
+ * Find the squares attacked from |sq| by a slider moving along |deltas|,
+ * the slow way. Used to fill in the magic attack tables.
+ */
+static bitboard_t slider_attacks(int sq, const int deltas[4][2],
+        bitboard_t occupied)
+{
+    bitboard_t attacks = EMPTY_BB;
+    for (int i=0; i<4; ++i) {
+        int file = sq % 8 + deltas[i][0], rank = sq / 8 + deltas[i][1];
+        for (; file >= 0 && file < 8 && rank >= 0 && rank < 8;
+                file += deltas[i][0], rank += deltas[i][1]) {
+            set_bit(attacks, rank*8 + file);
+            if (bit_is_set(occupied, rank*8 + file)) break;
+        }
+    }
+    return attacks;
+}
+
+/*
+ * Fill in the attack table for a slider on each square. Each square's
+ * table is indexed by the occupied squares on its rays, either gathered
+ * directly with pext or hashed by that square's magic multiplier.
+ */
+static void init_magics(magic_t* magics,
+        bitboard_t* table,
+        const bitboard_t* magic_numbers,
+        const int deltas[4][2])
+{
+    for (int sq=0; sq<64; ++sq) {
+        magic_t* m = &magics[sq];
+        // Edge squares never block anything, so they're left out of the
+        // occupancy mask unless the slider is on that edge.
+        bitboard_t edges =
+            ((RANK_1_BB | RANK_8_BB) & ~rank_mask[sq / 8]) |
+            ((FILE_A_BB | FILE_H_BB) & ~file_mask[sq % 8]);
+        m->mask = slider_attacks(sq, deltas, EMPTY_BB) & ~edges;
+        m->shift = 64 - popcount(m->mask);
+        m->magic = magic_numbers ? magic_numbers[sq] : 0;
+        m->attacks = table;
+        table += 1ull << popcount(m->mask);
+
+        // Enumerate every subset of the mask.
+        bitboard_t occupied = EMPTY_BB;
+        do {
+            bitboard_t attacks = slider_attacks(sq, deltas, occupied);
+            bitboard_t* entry = &m->attacks[magic_index(m, occupied)];
+            assert(!*entry || *entry == attacks);
+            *entry = attacks;
+            occupied = (occupied - m->mask) & m->mask;
+        } while (occupied);
+    }
+}
+
 /*
  * Set all static bitboards to their appropriate values.
  */
@@ -62,6 +179,88 @@ void init_bitboards(void)
         in_front_mask[WHITE][sq] &= file_mask[sq_file];
         in_front_mask[BLACK][sq] &= file_mask[sq_file];
     }
+
+    // Squares strictly between each pair of squares on a common line, and
+    // the whole line through them from edge to edge.
+    for (int sq=0; sq<64; ++sq) {
+        for (int to=0; to<64; ++to) {
+            between_mask[sq][to] = line_mask[sq][to] = EMPTY_BB;
+            int file_delta = to % 8 - sq % 8;
+            int rank_delta = to / 8 - sq / 8;
+            if (to == sq || (file_delta && rank_delta &&
+                        abs(file_delta) != abs(rank_delta))) continue;
+            int step = (file_delta > 0) - (file_delta < 0) +
+                8 * ((rank_delta > 0) - (rank_delta < 0));
+            for (int ind=sq+step; ind!=to; ind+=step) {
+                set_bit(between_mask[sq][to], ind);
+            }
+            direction_t dir = (file_delta > 0) - (file_delta < 0) +
+                16 * ((rank_delta > 0) - (rank_delta < 0));
+            square_t from = index_to_square(sq);
+            for (square_t x=from; valid_board_index(x); x+=dir) {
+                set_sq_bit(line_mask[sq][to], x);
+            }
+            for (square_t x=from-dir; valid_board_index(x); x-=dir) {
+                set_sq_bit(line_mask[sq][to], x);
+            }
+        }
+    }
+
+    // Attacks for the pieces that don't slide.
+    for (int sq=0; sq<64; ++sq) {
+        square_t from = index_to_square(sq);
+        knight_attacks[sq] = king_attacks[sq] = EMPTY_BB;
+        pawn_attacks[WHITE][sq] = pawn_attacks[BLACK][sq] = EMPTY_BB;
+        for (const direction_t* delta=piece_deltas[WN]; *delta; ++delta) {
+            if (valid_board_index(from + *delta)) {
+                set_sq_bit(knight_attacks[sq], from + *delta);
+            }
+        }
+        for (const direction_t* delta=piece_deltas[WK]; *delta; ++delta) {
+            if (valid_board_index(from + *delta)) {
+                set_sq_bit(king_attacks[sq], from + *delta);
+            }
+        }
+        for (color_t side=WHITE; side<=BLACK; ++side) {
+            piece_t pawn = create_piece(side, PAWN);
+            for (const direction_t* delta=piece_deltas[pawn]; *delta; ++delta) {
+                if (valid_board_index(from + *delta)) {
+                    set_sq_bit(pawn_attacks[side][sq], from + *delta);
+                }
+            }
+        }
+    }
+
+    static const int bishop_deltas[4][2] = {{1,1}, {1,-1}, {-1,1}, {-1,-1}};
+    static const int rook_deltas[4][2] = {{1,0}, {-1,0}, {0,1}, {0,-1}};
+#ifdef USE_PEXT
+    init_magics(bishop_magics, bishop_attack_table, NULL, bishop_deltas);
+    init_magics(rook_magics, rook_attack_table, NULL, rook_deltas);
+#else
+    init_magics(bishop_magics, bishop_attack_table,
+            bishop_magic_numbers, bishop_deltas);
+    init_magics(rook_magics, rook_attack_table,
+            rook_magic_numbers, rook_deltas);
+#endif
+}
+
+/*
+ * Find the squares attacked by |piece| standing on the square with index
+ * |ind|, given the set of occupied squares. A slider's attacks include the
+ * first occupied square on each ray, whichever side it belongs to.
+ */
+bitboard_t attacks_from(piece_t piece, int ind, bitboard_t occupied)
+{
+    switch (piece_type(piece)) {
+        case PAWN: return pawn_attacks[piece_color(piece)][ind];
+        case KNIGHT: return knight_attacks[ind];
+        case BISHOP: return bishop_attacks(ind, occupied);
+        case ROOK: return rook_attacks(ind, occupied);
+        case QUEEN: return queen_attacks(ind, occupied);
+        case KING: return king_attacks[ind];
+        default: assert(false);
+    }
+    return EMPTY_BB;
 }
 
 /*
@@ -82,3 +281,13 @@ void print_bitboard(bitboard_t bb)
     }
     printf("\n");
 }
+
+/*
+ * Count the set bits in |bb|, for compilers without a popcount builtin.
+ */
+int count_bits(bitboard_t bb)
+{
+    int count = 0;
+    for (; bb; bb &= bb - 1) ++count;
+    return count;
+}
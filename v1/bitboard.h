@@ -37,7 +37,30 @@ extern bitboard_t neighbor_file_mask[8];
 extern bitboard_t in_front_mask[2][64];
 extern bitboard_t outpost_mask[2][64];
 extern bitboard_t passed_mask[2][64];
+extern bitboard_t between_mask[64][64];
+extern bitboard_t line_mask[64][64];
 extern const int bit_table[64];
+extern bitboard_t knight_attacks[64];
+extern bitboard_t king_attacks[64];
+extern bitboard_t pawn_attacks[2][64];
+
+// Slider attacks are looked up by hashing the occupied squares on the
+// slider's rays. With BMI2 the relevant occupancy bits are gathered directly
+// with pext; otherwise they're hashed by a magic multiplication.
+#if defined(__BMI2__) && defined(__x86_64__) && !defined(NO_PEXT)
+#define USE_PEXT
+#include <immintrin.h>
+#endif
+
+typedef struct {
+    bitboard_t mask;
+    bitboard_t magic;
+    bitboard_t* attacks;
+    int shift;
+} magic_t;
+
+extern magic_t bishop_magics[64];
+extern magic_t rook_magics[64];
 
 #define set_bit(bb, ind)        ((bb) |= set_mask[ind])
 #define set_sq_bit(bb, sq)      ((bb) |= set_mask[square_to_index(sq)])
@@ -45,8 +68,36 @@ extern const int bit_table[64];
 #define clear_sq_bit(bb, sq)    ((bb) &= clear_mask[square_to_index(sq)])
 #define bit_is_set(bb, ind)     ((bb) & set_mask[ind])
 #define sq_bit_is_set(bb, sq)   ((bb) & set_mask[square_to_index(sq)])
+#define squares_between(from, to)   \
+    (between_mask[square_to_index(from)][square_to_index(to)])
+#if defined(__GNUC__)
+#define first_bit(bb)           __builtin_ctzll(bb)
+#else
 #define first_bit(bb)           \
     (bit_table[(((bb) & (~(bb)+1)) * 0x0218A392CD3D5DBFull) >> 58])
+#endif
+
+#ifdef USE_PEXT
+#define magic_index(m, occ)     _pext_u64((occ), (m)->mask)
+#else
+#define magic_index(m, occ)     \
+    (int)((((occ) & (m)->mask) * (m)->magic) >> (m)->shift)
+#endif
+#define bishop_attacks(ind, occ)    \
+    (bishop_magics[ind].attacks[magic_index(&bishop_magics[ind], occ)])
+#define rook_attacks(ind, occ)      \
+    (rook_magics[ind].attacks[magic_index(&rook_magics[ind], occ)])
+#define queen_attacks(ind, occ)     \
+    (bishop_attacks(ind, occ) | rook_attacks(ind, occ))
+
+#if defined(__GNUC__)
+#define popcount(bb)            __builtin_popcountll(bb)
+#elif defined(_MSC_VER) && defined(_WIN64)
+#include <intrin.h>
+#define popcount(bb)            ((int)__popcnt64(bb))
+#else
+#define popcount(bb)            count_bits(bb)
+#endif
 
 #ifdef __cplusplus
 }
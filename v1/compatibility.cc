@@ -1,10 +1,16 @@
 
 #include "daydreamer.h"
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
 
 /*
  * Implementations of functions that don't exist on all platforms.
- * Right now this is just adding some string handling functions for
- * the Windows build and a standard 32-bit PRNG.
+ * Right now this is adding some string handling functions for the Windows
+ * build, a standard 32-bit PRNG, and allocation of large hash tables.
  */
 
 #ifdef _WIN32
@@ -140,3 +146,333 @@ int64_t random_64(void)
 }
 
 #endif
+
+#ifdef _WIN32
+
+/*
+ * Get memory for |mem| from the operating system. Large pages are only
+ * available to processes holding the lock pages in memory privilege, so
+ * ordinary pages are the usual result.
+ */
+static bool map_table_memory(table_memory_t* mem, size_t bytes, int flags)
+{
+    SIZE_T large_page = GetLargePageMinimum();
+    if ((flags & TABLE_LARGE_PAGES) && large_page && bytes >= large_page) {
+        size_t rounded = (bytes + large_page - 1) & ~(large_page - 1);
+        mem->base = VirtualAlloc(NULL, rounded,
+                MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (mem->base) {
+            mem->mapped_bytes = rounded;
+            mem->mode = TABLE_MEMORY_HUGE_PAGES;
+            return true;
+        }
+    }
+    mem->base = VirtualAlloc(NULL, bytes,
+            MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!mem->base) return false;
+    mem->mapped_bytes = bytes;
+    mem->mode = TABLE_MEMORY_PAGES;
+    return true;
+}
+
+static void unmap_table_memory(table_memory_t* mem)
+{
+    if (mem->mode == TABLE_MEMORY_FILE) UnmapViewOfFile(mem->base);
+    else VirtualFree(mem->base, 0, MEM_RELEASE);
+}
+
+/*
+ * Map the first |bytes| of |filename| copy-on-write.
+ */
+static void* map_file(const char* filename, size_t bytes)
+{
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    HANDLE mapping = CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return NULL;
+    void* p = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, bytes);
+    CloseHandle(mapping);
+    return p;
+}
+
+static bool lock_table_memory(table_memory_t* mem)
+{
+    // Large pages are never paged out.
+    if (mem->mode == TABLE_MEMORY_HUGE_PAGES) return true;
+    return VirtualLock(mem->ptr, mem->bytes) != 0;
+}
+
+#else
+
+/*
+ * Get memory for |mem| from the operating system, preferring huge pages
+ * reserved by the administrator (vm.nr_hugepages), then transparent huge
+ * pages, then ordinary pages. Transparent huge pages only cover huge page
+ * aligned ranges, so the mapping is padded to allow for alignment.
+ */
+static bool map_table_memory(table_memory_t* mem, size_t bytes, int flags)
+{
+    const int prot = PROT_READ | PROT_WRITE;
+    const int map_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    if (!(flags & TABLE_LARGE_PAGES) || bytes < HUGE_PAGE_BYTES) {
+        mem->base = mmap(NULL, bytes, prot, map_flags, -1, 0);
+        if (mem->base == MAP_FAILED) return false;
+        mem->mapped_bytes = bytes;
+        mem->mode = TABLE_MEMORY_PAGES;
+        return true;
+    }
+    size_t rounded = (bytes + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+#ifdef MAP_HUGETLB
+    mem->base = mmap(NULL, rounded, prot, map_flags | MAP_HUGETLB, -1, 0);
+    if (mem->base != MAP_FAILED) {
+        mem->mapped_bytes = rounded;
+        mem->mode = TABLE_MEMORY_HUGE_PAGES;
+        return true;
+    }
+#endif
+    mem->base = mmap(NULL, rounded + HUGE_PAGE_BYTES, prot, map_flags, -1, 0);
+    if (mem->base == MAP_FAILED) return false;
+    mem->mapped_bytes = rounded + HUGE_PAGE_BYTES;
+    mem->mode = TABLE_MEMORY_PAGES;
+#ifdef MADV_HUGEPAGE
+    void* aligned = (void*)(((uintptr_t)mem->base + HUGE_PAGE_BYTES - 1) &
+            ~(uintptr_t)(HUGE_PAGE_BYTES - 1));
+    if (!madvise(aligned, rounded, MADV_HUGEPAGE)) {
+        mem->mode = TABLE_MEMORY_TRANSPARENT_HUGE_PAGES;
+    }
+#endif
+    return true;
+}
+
+static void unmap_table_memory(table_memory_t* mem)
+{
+    munmap(mem->base, mem->mapped_bytes);
+}
+
+/*
+ * Map the first |bytes| of |filename| copy-on-write.
+ */
+static void* map_file(const char* filename, size_t bytes)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static bool lock_table_memory(table_memory_t* mem)
+{
+    return mlock(mem->ptr, mem->bytes) == 0;
+}
+
+#endif
+
+/*
+ * The number of processors available to us.
+ */
+int num_processors(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return MAX((int)info.dwNumberOfProcessors, 1);
+#else
+    return MAX((int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+#endif
+}
+
+// Tables are split into chunks for zeroing, with each chunk written by its
+// own thread. Small tables aren't worth starting threads for.
+#define MAX_MEMORY_THREADS      64
+#define MIN_MEMORY_CHUNK_BYTES  (16*1024*1024)
+#define PAGE_BYTES              4096
+
+typedef struct {
+    char* start;
+    size_t bytes;
+    bool touch_only;
+    int cpu;
+    thread_t thread;
+} memory_chunk_t;
+
+/*
+ * Zero a chunk of memory, or if the chunk is known to be zero already, just
+ * write to each page to fault it in. On NUMA systems, pages are placed on
+ * the node of the thread that first touches them, so each thread is pinned
+ * to its own processor to spread the table over all nodes.
+ */
+static void write_memory_chunk(memory_chunk_t* chunk)
+{
+#if defined(__linux__) && defined(CPU_SET)
+    if (chunk->cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(chunk->cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+#endif
+    if (!chunk->touch_only) {
+        memset(chunk->start, 0, chunk->bytes);
+        return;
+    }
+    volatile char* p = (volatile char*)chunk->start;
+    for (size_t i=0; i<chunk->bytes; i+=PAGE_BYTES) p[i] = 0;
+}
+
+static THREAD_FN(memory_chunk_thread, arg)
+{
+    write_memory_chunk((memory_chunk_t*)arg);
+    THREAD_RETURN;
+}
+
+/*
+ * Zero or touch |bytes| of memory starting at |ptr|, splitting the work over
+ * all processors. Chunks are page aligned, so no two threads touch the same
+ * page. If threads can't be started, the calling thread does their work.
+ */
+static void write_table_memory(void* ptr, size_t bytes, bool touch_only)
+{
+    int num_chunks = CLAMP((int)(bytes / MIN_MEMORY_CHUNK_BYTES),
+            1, MIN(num_processors(), MAX_MEMORY_THREADS));
+    memory_chunk_t chunks[MAX_MEMORY_THREADS];
+    size_t chunk_bytes = (bytes / num_chunks + PAGE_BYTES - 1) &
+        ~(size_t)(PAGE_BYTES - 1);
+    char* start = (char*)ptr;
+    char* end = start + bytes;
+    for (int i=0; i<num_chunks; ++i) {
+        chunks[i].start = start;
+        chunks[i].bytes = MIN(chunk_bytes, (size_t)(end - start));
+        chunks[i].touch_only = touch_only;
+        chunks[i].cpu = -1;
+        start += chunks[i].bytes;
+    }
+#if defined(__linux__) && defined(CPU_SET)
+    // Pin chunks only to processors this thread is allowed to run on, and
+    // put its affinity back afterwards, since threads it starts later
+    // inherit it.
+    cpu_set_t allowed;
+    const bool pin = num_chunks > 1 &&
+        !pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed);
+    if (pin) {
+        int cpu = -1;
+        for (int i=0; i<num_chunks; ++i) {
+            do cpu = (cpu + 1) % CPU_SETSIZE; while (!CPU_ISSET(cpu, &allowed));
+            chunks[i].cpu = cpu;
+        }
+    }
+#endif
+    bool started[MAX_MEMORY_THREADS];
+    for (int i=1; i<num_chunks; ++i) {
+        started[i] = create_thread(&chunks[i].thread,
+                memory_chunk_thread, &chunks[i]);
+    }
+    write_memory_chunk(&chunks[0]);
+    for (int i=1; i<num_chunks; ++i) {
+        if (started[i]) join_thread(chunks[i].thread);
+        else write_memory_chunk(&chunks[i]);
+    }
+#if defined(__linux__) && defined(CPU_SET)
+    if (pin) pthread_setaffinity_np(pthread_self(), sizeof(allowed), &allowed);
+#endif
+}
+
+/*
+ * Allocate |bytes| of zeroed memory for a hash table, releasing anything
+ * |mem| held before. With TABLE_LARGE_PAGES, try to back the table with
+ * huge pages to cut down on TLB misses. With TABLE_LOCK, fault in the
+ * whole table now rather than during the first search, and try to lock it
+ * into physical memory. Otherwise pages are faulted in by whichever search
+ * thread first uses them. If the operating system won't give us pages
+ * directly we fall back to the heap. Returns false if no memory could be
+ * allocated at all.
+ */
+bool alloc_table_memory(table_memory_t* mem, size_t bytes, int flags)
+{
+    free_table_memory(mem);
+    if (map_table_memory(mem, bytes, flags)) {
+        mem->ptr = mem->base;
+        if (mem->mode == TABLE_MEMORY_TRANSPARENT_HUGE_PAGES) {
+            mem->ptr = (void*)(((uintptr_t)mem->base + HUGE_PAGE_BYTES - 1) &
+                    ~(uintptr_t)(HUGE_PAGE_BYTES - 1));
+        }
+    } else {
+        mem->base = calloc(bytes + CACHE_LINE_BYTES - 1, 1);
+        if (!mem->base) return false;
+        mem->mapped_bytes = bytes + CACHE_LINE_BYTES - 1;
+        mem->mode = TABLE_MEMORY_HEAP;
+        mem->ptr = (void*)(((uintptr_t)mem->base + CACHE_LINE_BYTES - 1) &
+                ~(uintptr_t)(CACHE_LINE_BYTES - 1));
+    }
+    mem->bytes = bytes;
+    if (flags & TABLE_LOCK) {
+        // Fault the pages in from all processors before locking, so that
+        // first-touch placement spreads them over all NUMA nodes.
+        write_table_memory(mem->ptr, bytes, true);
+        mem->locked = lock_table_memory(mem);
+    }
+    return true;
+}
+
+/*
+ * Zero all the memory held by |mem|. Large tables are cleared by one
+ * thread per processor.
+ */
+void clear_table_memory(table_memory_t* mem)
+{
+    write_table_memory(mem->ptr, mem->bytes, false);
+}
+
+/*
+ * Use the |bytes| of |filename| that start at |offset| as table memory,
+ * releasing anything |mem| held before. The file is mapped rather than
+ * read, so pages are only read in as the table uses them, and changes to
+ * the table are never written back to the file. |offset| should be a
+ * multiple of the page size.
+ */
+bool map_table_file(table_memory_t* mem,
+        const char* filename,
+        size_t offset,
+        size_t bytes)
+{
+    free_table_memory(mem);
+    mem->base = map_file(filename, offset + bytes);
+    if (!mem->base) return false;
+    mem->mapped_bytes = offset + bytes;
+    mem->mode = TABLE_MEMORY_FILE;
+    mem->ptr = (char*)mem->base + offset;
+    mem->bytes = bytes;
+    return true;
+}
+
+/*
+ * Release memory allocated by |alloc_table_memory| or |map_table_file|.
+ */
+void free_table_memory(table_memory_t* mem)
+{
+    if (mem->mode == TABLE_MEMORY_HEAP) free(mem->base);
+    else if (mem->mode != TABLE_MEMORY_NONE) unmap_table_memory(mem);
+    memset(mem, 0, sizeof(table_memory_t));
+}
+
+/*
+ * A short description of how |mem| was allocated, for info strings.
+ */
+const char* table_memory_description(const table_memory_t* mem)
+{
+    switch (mem->mode) {
+        case TABLE_MEMORY_HUGE_PAGES:
+            return mem->locked ? "huge pages, locked" : "huge pages";
+        case TABLE_MEMORY_TRANSPARENT_HUGE_PAGES:
+            return mem->locked ? "transparent huge pages, locked" :
+                "transparent huge pages";
+        case TABLE_MEMORY_PAGES:
+            return mem->locked ? "normal pages, locked" : "normal pages";
+        case TABLE_MEMORY_HEAP:
+            return mem->locked ? "heap, locked" : "heap";
+        case TABLE_MEMORY_FILE: return "mapped from file";
+        default: return "unallocated";
+    }
+}
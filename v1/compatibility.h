@@ -25,6 +25,8 @@ extern "C" {
 // provide an implementation where there is no equivalent.
 #include <windows.h>
 #define strcasecmp      _stricmp
+#define fseeko          _fseeki64
+#define ftello          _ftelli64
 #define strncasecmp     _strnicmp
 int _strnicmp(const char *string1, const char *string2, size_t count);
 int _stricmp(const char *string1, const char *string2);
@@ -60,11 +62,107 @@ typedef __int16 int16_t;
 #   define  CACHE_ALIGN __attribute__ ((aligned(CACHE_LINE_BYTES)))
 #endif
 
+// Inline a function even when it's too big for the compiler to choose to,
+// so that each call with constant arguments gets its own specialized copy.
+#if defined(_MSC_VER)
+#   define  FORCE_INLINE __forceinline
+#elif defined(__GNUC__) || defined(__clang__)
+#   define  FORCE_INLINE inline __attribute__ ((always_inline))
+#else
+#   define  FORCE_INLINE inline
+#endif
+
+// Hint that the cache line containing |addr| will be read soon.
+#if defined(__GNUC__) || defined(__clang__)
+#   define prefetch_address(addr)   __builtin_prefetch((addr))
+#elif defined(_MSC_VER)
+#   include <xmmintrin.h>
+#   define prefetch_address(addr)   \
+    _mm_prefetch((const char*)(addr), _MM_HINT_T0)
+#else
+#   define prefetch_address(addr)
+#endif
+
+// Memory for large hash tables. Depending on what the platform and its
+// configuration allow, a table may be backed by explicitly reserved huge
+// pages, by transparent huge pages, or by ordinary pages. Table memory is
+// always zero filled and cache line aligned when allocated. Tables can also
+// be mapped copy-on-write from a file.
+#define HUGE_PAGE_BYTES     (2*1024*1024)
+#define TABLE_LARGE_PAGES   0x01
+#define TABLE_LOCK          0x02
+
+typedef enum {
+    TABLE_MEMORY_NONE,
+    TABLE_MEMORY_HEAP,
+    TABLE_MEMORY_PAGES,
+    TABLE_MEMORY_TRANSPARENT_HUGE_PAGES,
+    TABLE_MEMORY_HUGE_PAGES,
+    TABLE_MEMORY_FILE
+} table_memory_mode_t;
+
+typedef struct {
+    void* ptr;
+    size_t bytes;
+    void* base;
+    size_t mapped_bytes;
+    table_memory_mode_t mode;
+    bool locked;
+} table_memory_t;
+
 // Threading support
 #define	_REENTRANT
 #define _PTHREADS
 #define _POSIX_PTHREAD_SEMANTICS
 
+// Portable wrappers for the few threading primitives used by the search.
+// Threads run a thread_fn_t and are created with an explicit stack size,
+// since the search recursion needs more than the default on some platforms.
+#define THREAD_STACK_BYTES  (16*1024*1024)
+#ifdef WINDOWS_THREADS
+typedef HANDLE thread_t;
+typedef CRITICAL_SECTION mutex_t;
+#define THREAD_FN(name, arg)    DWORD WINAPI name(LPVOID arg)
+#define THREAD_RETURN           return 0
+#define create_thread(t, fn, arg) \
+    ((*(t) = CreateThread(NULL, THREAD_STACK_BYTES, (fn), (arg), 0, NULL)) \
+     != NULL)
+#define join_thread(t) \
+    do { WaitForSingleObject((t), INFINITE); CloseHandle(t); } while (0)
+#define init_mutex(m)           InitializeCriticalSection(m)
+#define destroy_mutex(m)        DeleteCriticalSection(m)
+#define lock_mutex(m)           EnterCriticalSection(m)
+#define unlock_mutex(m)         LeaveCriticalSection(m)
+#define THREAD_LOCAL            __declspec(thread)
+#define yield_thread()          SwitchToThread()
+#else
+#include <pthread.h>
+#include <sched.h>
+typedef pthread_t thread_t;
+typedef pthread_mutex_t mutex_t;
+#define THREAD_FN(name, arg)    void* name(void* arg)
+#define THREAD_RETURN           return NULL
+#define create_thread(t, fn, arg)   create_pthread((t), (fn), (arg))
+#define join_thread(t)          pthread_join((t), NULL)
+#define init_mutex(m)           pthread_mutex_init((m), NULL)
+#define destroy_mutex(m)        pthread_mutex_destroy(m)
+#define lock_mutex(m)           pthread_mutex_lock(m)
+#define unlock_mutex(m)         pthread_mutex_unlock(m)
+#define THREAD_LOCAL            __thread
+#define yield_thread()          sched_yield()
+static inline bool create_pthread(pthread_t* t,
+        void*(*fn)(void*),
+        void* arg)
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, THREAD_STACK_BYTES);
+    bool ok = pthread_create(t, &attr, fn, arg) == 0;
+    pthread_attr_destroy(&attr);
+    return ok;
+}
+#endif
+
 // 32 or 64 bit?
 #if defined(__x86_64) || \
     defined(_WIN64) || \
@@ -34,8 +34,8 @@ extern "C" {
 #include "position.h"
 #include "attack.h"
 #include "timer.h"
-#include "search.h"
 #include "trans_table.h"
+#include "search.h"
 #include "move_selection.h"
 #include "debug.h"
 
@@ -49,15 +49,23 @@ direction_t pin_direction(const position_t* pos,
         square_t from,
         square_t king_sq);
 bool is_square_attacked(const position_t* pos, square_t square, color_t side);
+bitboard_t attackers_to(const position_t* pos, int ind, bitboard_t occupied);
+bitboard_t king_blockers(const position_t* pos,
+        color_t king_side,
+        color_t side);
 bool piece_attacks_near(const position_t* pos, square_t from, square_t target);
+void init_check_info(const position_t* pos, check_info_t* ci);
 uint8_t find_checks(position_t* pos);
+uint8_t find_move_checks(position_t* pos, move_t move);
 
 // benchmark.c
 void benchmark(int depth, int time_limit);
 
 // bitboard.c
 void init_bitboards(void);
+bitboard_t attacks_from(piece_t piece, int ind, bitboard_t occupied);
 void print_bitboard(bitboard_t bb);
+int count_bits(bitboard_t bb);
 
 // book_poly.c
 bool init_poly_book(char* filename);
@@ -72,6 +80,15 @@ move_t get_ctg_book_move(position_t* pos);
 void srandom_32(unsigned seed);
 int32_t random_32(void);
 int64_t random_64(void);
+bool alloc_table_memory(table_memory_t* mem, size_t bytes, int flags);
+bool map_table_file(table_memory_t* mem,
+        const char* filename,
+        size_t offset,
+        size_t bytes);
+void free_table_memory(table_memory_t* mem);
+void clear_table_memory(table_memory_t* mem);
+int num_processors(void);
+const char* table_memory_description(const table_memory_t* mem);
 
 // daydreamer.c
 void init_daydreamer(void);
@@ -82,37 +99,55 @@ void unload_scorpio_bb(void);
 bool probe_scorpio_bb(position_t* pos, int* value, int ply);
 
 // epd.c
-void epd_testsuite(char* filename, int time_per_problem);
+void epd_testsuite(char* filename, int time_per_problem, int num_threads);
 
 // eval.c
 void init_eval(void);
-int simple_eval(const position_t* pos);
+void init_eval_data(eval_data_t* ed,
+        pawn_table_t* pawn_table,
+        material_table_t* material_table,
+        eval_table_t* eval_table);
+void init_eval_table(eval_table_t* et, const int max_bytes);
+void destroy_eval_table(eval_table_t* et);
+void clear_eval_table(eval_table_t* et);
+void print_eval_stats(eval_table_t* et);
+int simple_eval(const position_t* pos, eval_data_t* ed);
 int full_eval(const position_t* pos, eval_data_t* ed);
+int lazy_eval(const position_t* pos, eval_data_t* ed, int alpha, int beta);
 void report_eval(const position_t* pos);
 bool insufficient_material(const position_t* pos);
 bool can_win(const position_t* pos, color_t side);
 bool is_draw(const position_t* pos);
 
+// eval_attacks.c
+void compute_attack_map(const position_t* pos, eval_data_t* ed);
+
 // eval_king.c
 score_t evaluate_king_safety(const position_t* pos, eval_data_t* ed);
 
 // eval_material.c
-void init_material_table(const int max_bytes);
-void clear_material_table(void);
-material_data_t* get_material_data(const position_t* pos);
+void init_material_table(material_table_t* mt, const int max_bytes);
+void destroy_material_table(material_table_t* mt);
+void clear_material_table(material_table_t* mt);
+material_data_t* get_material_data(material_table_t* mt,
+        const position_t* pos);
 int game_phase(const position_t* pos);
 
 // eval_patterns.c
 score_t pattern_score(const position_t*pos);
 
 // eval_pawns.c
-void init_pawn_table(const int max_bytes);
-void clear_pawn_table(void);
-score_t pawn_score(const position_t* pos, pawn_data_t** pawn_data);
-void print_pawn_stats(void);
+void init_pawn_table(pawn_table_t* pt, const int max_bytes);
+void destroy_pawn_table(pawn_table_t* pt);
+void clear_pawn_table(pawn_table_t* pt);
+pawn_data_t* analyze_pawns(pawn_table_t* pt, const position_t* pos);
+score_t pawn_score(pawn_table_t* pt,
+        const position_t* pos,
+        pawn_data_t** pawn_data);
+void print_pawn_stats(pawn_table_t* pt);
 
 // eval_pieces.c
-score_t pieces_score(const position_t* pos, pawn_data_t* pd);
+score_t pieces_score(const position_t* pos, eval_data_t* ed);
 
 // format.c
 int square_to_coord_str(square_t sq, char* str);
@@ -135,7 +170,8 @@ bool probe_gtb_firm_dtm(const position_t* pos, int* score);
 
 // hash.c
 void init_hash(void);
-int get_hashfull(void);
+hashkey_t hash_signature(void);
+int get_hashfull(transposition_table_t* tt);
 hashkey_t hash_position(const position_t* pos);
 hashkey_t hash_pawns(const position_t* pos);
 hashkey_t hash_material(const position_t* pos);
@@ -160,9 +196,18 @@ int generate_pseudo_checks(const position_t* pos, move_t* moves);
 int generate_quiescence_moves(const position_t* pos,
         move_t* moves,
         bool generate_checks);
+int generate_castles(const position_t* pos, move_t* moves);
+
+// move_generation_bitboard.c
+int generate_bitboard_tactical_moves(const position_t* pos, move_t* moves);
+int generate_bitboard_quiet_moves(const position_t* pos, move_t* moves);
+int generate_bitboard_legal_moves(position_t* pos, move_t* moves);
+int generate_bitboard_evasions(const position_t* pos, move_t* moves);
+int generate_bitboard_checks(const position_t* pos, move_t* moves);
 
 // move_selection.c
 void init_move_selector(move_selector_t* sel,
+        search_data_t* data,
         position_t* pos,
         generation_t gen_type,
         search_node_t* search_node,
@@ -173,12 +218,17 @@ bool has_single_reply(move_selector_t* sel);
 bool should_try_prune(move_selector_t* sel, move_t move);
 float lmr_reduction(move_selector_t* sel, move_t move, bool full_window);
 move_t select_move(move_selector_t* sel);
+move_t select_shared_move(move_selector_t* sel,
+        bool full_window,
+        int* move_number,
+        float* lmr_red);
 bool defer_move(move_selector_t* sel, move_t move);
-void init_pv_cache(const int max_bytes);
-void clear_pv_cache(void);
+void init_pv_cache(pv_cache_t* pc, const int max_bytes);
+void destroy_pv_cache(pv_cache_t* pc);
+void clear_pv_cache(pv_cache_t* pc);
 void add_pv_move(move_selector_t* sel, move_t move, int64_t nodes);
 void commit_pv_moves(move_selector_t* sel);
-void print_pv_cache_stats(void);
+void print_pv_cache_stats(pv_cache_t* pc);
 
 // output.c
 void print_coord_move(move_t move);
@@ -189,6 +239,7 @@ void print_board(const position_t* pos, bool uci_prefix);
 void print_multipv(search_data_t* data);
 
 // perft.c
+void init_perft_table(const size_t max_bytes);
 void perft_testsuite(char* filename);
 uint64_t perft(position_t* position, int depth, bool divide);
 
@@ -199,20 +250,37 @@ void flip_position(position_t* flipped, const position_t* src);
 bool is_move_legal(position_t* pos, const move_t move);
 bool is_plausible_move_legal(position_t* pos, move_t move);
 bool is_pseudo_move_legal(position_t* pos, move_t move);
+bool is_pseudo_move_legal_ci(position_t* pos,
+        const check_info_t* ci,
+        move_t move);
 bool is_check(const position_t* pos);
 bool is_repetition(const position_t* pos);
 
 // search.c
 void init_search_data(search_data_t* data);
-void init_root_move(root_move_t* root_move, move_t move);
+void init_root_move(search_data_t* data, root_move_t* root_move, move_t move);
 bool should_stop_searching(search_data_t* data);
 void store_root_node_count(move_t move, uint64_t nodes);
 void deepening_search(search_data_t* search_data, bool ponder);
+void helper_deepening_search(search_data_t* data);
+uint64_t total_nodes_searched(search_data_t* data);
+void search_split_point(search_data_t* data, split_point_t* sp);
 
 // static_exchange_eval.c
 int static_exchange_eval(const position_t* pos, move_t move);
+bool see_ge(const position_t* pos, move_t move, int threshold);
 int static_exchange_sign(const position_t* pos, move_t move);
 
+// threads.c
+void start_helper_threads(search_data_t* main_data);
+void stop_helper_threads(void);
+uint64_t helper_nodes_searched(void);
+bool idle_helper_available(void);
+int assign_split_point_helpers(split_point_t* sp);
+bool is_move_being_searched(hashkey_t hash, move_t move);
+void start_searching_move(hashkey_t hash, move_t move);
+void finish_searching_move(hashkey_t hash, move_t move);
+
 // timer.c
 void init_timer(milli_timer_t* timer);
 void start_timer(milli_timer_t* timer);
@@ -220,22 +288,32 @@ int stop_timer(milli_timer_t* timer);
 int elapsed_time(milli_timer_t* timer);
 
 // trans_table.c
-void init_transposition_table(const size_t max_bytes);
-void clear_transposition_table(void);
-void increment_transposition_age(void);
-transposition_entry_t* get_transposition(position_t* pos);
-void put_transposition(position_t* pos,
+void init_transposition_table(transposition_table_t* tt,
+        const size_t max_bytes);
+void destroy_transposition_table(transposition_table_t* tt);
+void clear_transposition_table(transposition_table_t* tt);
+void increment_transposition_age(transposition_table_t* tt);
+transposition_entry_t* get_transposition(transposition_table_t* tt,
+        position_t* pos,
+        transposition_entry_t* entry);
+void put_transposition(transposition_table_t* tt,
+        position_t* pos,
         move_t move,
         float depth,
         int score,
         score_type_t score_type,
         bool mate_threat);
-void put_transposition_line(position_t* pos,
+void put_transposition_line(transposition_table_t* tt,
+        position_t* pos,
         move_t* moves,
         float depth,
         int score,
         score_type_t score_type);
-void print_transposition_stats(void);
+void print_transposition_stats(transposition_table_t* tt);
+size_t transposition_table_bytes(const transposition_table_t* tt);
+int replacement_policy_index(const char* name);
+bool save_transposition_table(transposition_table_t* tt, const char* filename);
+bool load_transposition_table(transposition_table_t* tt, const char* filename);
 
 // uci.c
 void uci_read_stream(FILE* stream);
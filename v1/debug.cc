@@ -25,6 +25,21 @@ void _check_board_validity(const position_t* pos)
             assert(pos->pieces[side][pos->piece_index[sq]] == sq);
         }
     }
+    for (piece_t piece=WP; piece<=BK; ++piece) {
+        bitboard_t bb = EMPTY_BB;
+        for (square_t sq=A1; sq<=H8; ++sq) {
+            if (valid_board_index(sq) && pos->board[sq] == piece) {
+                set_sq_bit(bb, sq);
+            }
+        }
+        assert(pos->piece_bb[piece] == bb);
+    }
+    assert(pos->color_bb[WHITE] == (pos->piece_bb[WP] | pos->piece_bb[WN] |
+                pos->piece_bb[WB] | pos->piece_bb[WR] |
+                pos->piece_bb[WQ] | pos->piece_bb[WK]));
+    assert(pos->color_bb[BLACK] == (pos->piece_bb[BP] | pos->piece_bb[BN] |
+                pos->piece_bb[BB] | pos->piece_bb[BR] |
+                pos->piece_bb[BQ] | pos->piece_bb[BK]));
     assert(my_piece_count[WK] == 1);
     assert(my_piece_count[BK] == 1);
     for (int i=0; i<16; ++i) {
@@ -89,6 +104,19 @@ void _check_position_hash(const position_t* pos)
     assert(hash_position(pos) == pos->hash);
 }
 
+/*
+ * Make sure that the checks found incrementally after a move match a full
+ * search for checkers.
+ */
+void _check_move_checks(position_t* pos)
+{
+    uint8_t is_check = pos->is_check;
+    square_t check_square = pos->check_square;
+    (void)is_check; (void)check_square;
+    assert(find_checks(pos) == is_check);
+    assert(pos->check_square == check_square);
+}
+
 /*
  * Verify that a given list of moves in valid in the given position.
  */
@@ -104,14 +132,19 @@ void _check_line(position_t* pos, move_t* moves)
 }
 
 /*
- * Verify that flipping the board doesn't change the evaluation.
+ * Verify that flipping the board doesn't change the evaluation. The flipped
+ * position is evaluated with the pawn and material tables from |ed|, which
+ * belong to the calling thread, and without an eval cache.
  */
-void _check_eval_symmetry(const position_t* pos, int normal_eval)
+void _check_eval_symmetry(const position_t* pos,
+        const eval_data_t* ed,
+        int normal_eval)
 {
-    eval_data_t ed;
+    eval_data_t flipped_ed;
+    init_eval_data(&flipped_ed, ed->pawn_table, ed->material_table, NULL);
     position_t flipped_pos;
     flip_position(&flipped_pos, pos);
-    int flipped_eval = full_eval(&flipped_pos, &ed);
+    int flipped_eval = full_eval(&flipped_pos, &flipped_ed);
     if (normal_eval != flipped_eval) {
         printf("Asymmetric eval. Original:\n");
         print_board(pos, false);
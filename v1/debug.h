@@ -70,23 +70,28 @@ void _check_board_validity(const position_t* pos);
 void _check_move_validity(const position_t* pos, move_t move);
 void _check_pseudo_move_legality(position_t* pos, move_t move);
 void _check_position_hash(const position_t* pos);
+void _check_move_checks(position_t* pos);
 void _check_line(position_t* pos, move_t* line);
-void _check_eval_symmetry(const position_t* pos, int normal_eval);
+void _check_eval_symmetry(const position_t* pos,
+        const eval_data_t* ed,
+        int normal_eval);
 
 #ifndef EXPENSIVE_CHECKS
 #define check_board_validity(x)                 ((void)0)
 #define check_move_validity(x,y)                ((void)0,(void)0)
 #define check_pseudo_move_legality(x,y)         ((void)0)
 #define check_position_hash(x)                  ((void)0)
+#define check_move_checks(x)                    ((void)0)
 #define check_line(x,y)                         ((void)0)
-#define check_eval_symmetry(x,y)                ((void)0)
+#define check_eval_symmetry(x,y,z)              ((void)0)
 #else
 #define check_board_validity(x)                 _check_board_validity(x)
 #define check_move_validity(x,y)                _check_move_validity(x,y)
 #define check_pseudo_move_legality(x,y)         _check_pseudo_move_legality(x,y)
 #define check_position_hash(x)                  _check_position_hash(x)
+#define check_move_checks(x)                    _check_move_checks(x)
 #define check_line(x,y)                         _check_line(x,y)
-#define check_eval_symmetry(x,y)                _check_eval_symmetry(x,y)
+#define check_eval_symmetry(x,y,z)              _check_eval_symmetry(x,y,z)
 #endif
 
 #ifdef __cplusplus
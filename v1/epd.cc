@@ -1,61 +1,257 @@
 #include "daydreamer.h"
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-void epd_testsuite(char* filename, int time_per_problem)
+#define MAX_EPD_LINE    4096
+#define MAX_EPD_ID      128
+
+typedef struct {
+    char fen[MAX_EPD_LINE];
+    char id[MAX_EPD_ID];
+    move_t best_move;
+    move_t result;
+    int time;
+    int solution_time;
+    bool done;
+} epd_test_t;
+
+typedef struct {
+    search_data_t data;
+    transposition_table_t trans_table;
+    pawn_table_t pawn_table;
+    material_table_t material_table;
+    eval_table_t eval_table;
+    pv_cache_t pv_cache;
+    thread_t thread;
+} epd_worker_t;
+
+// State shared by all workers running a test suite. Workers claim tests in
+// file order, and whichever worker finishes a test prints the results of
+// any tests that are now complete, so output stays in file order.
+static struct {
+    epd_test_t* tests;
+    int num_tests;
+    int next_test;
+    int next_report;
+    int correct_tests;
+    int solved_time;
+    int time_per_problem;
+    mutex_t lock;
+} suite;
+
+/*
+ * Read the position, best move, and id from a line of an epd file. If there's
+ * no best move we can understand, the test's best move is NO_MOVE.
+ */
+static void parse_epd_test(char* line, epd_test_t* test)
+{
+    char *bm=NULL, *id=NULL, *token=NULL;
+    position_t pos;
+    memset(test, 0, sizeof(epd_test_t));
+    strcpy(test->fen, line);
+    set_position(&pos, line);
+    while ((token = strsep(&line, "; \t"))) {
+        if (!*token) continue;
+        if (strcasestr(token, "bm")) {
+            while (!bm || !*bm) bm = strsep(&line, "; \t");
+            test->best_move = san_str_to_move(&pos, bm);
+        }
+        if (strcasestr(token, "id")) {
+            strsep(&line, "\"");
+            id = strsep(&line, "\"");
+        }
+    }
+    if (id) strncpy(test->id, id, MAX_EPD_ID-1);
+}
+
+/*
+ * Read all tests from |filename|. Returns the number of tests read, or -1 if
+ * the file couldn't be read.
+ */
+static int read_epd_tests(char* filename, epd_test_t** tests)
 {
-    char test_storage[4096];
-    char* test = test_storage;
-    milli_timer_t epd_timer;
-    init_timer(&epd_timer);
     FILE* test_file = fopen(filename, "r");
     if (!test_file) {
         printf("Couldn't open epd test file %s: %s\n",
                 filename, strerror(errno));
-        return;
+        return -1;
     }
-    int total_tests = 0, correct_tests = 0;
-    while (fgets(test, 4096, test_file)) {
-        char *bm=NULL, *id=NULL, *token=NULL;
-        move_t best_move = NO_MOVE;
-        init_search_data(&root_data);
-        set_position(&root_data.root_pos, test);
-        print_board(&root_data.root_pos, false);
-        while ((token = strsep(&test, "; \t"))) {
-            if (!*token) continue;
-            if (strcasestr(token, "bm")) {
-                while (!bm || !*bm) bm = strsep(&test, "; \t");
-                best_move = san_str_to_move(&root_data.root_pos, bm);
-            }
-            if (strcasestr(token, "id")) {
-                strsep(&test, "\"");
-                id = strsep(&test, "\"");
-            }
+    char line[MAX_EPD_LINE];
+    int num_tests = 0, capacity = 0;
+    *tests = NULL;
+    while (fgets(line, MAX_EPD_LINE, test_file)) {
+        if (num_tests == capacity) {
+            capacity = capacity ? 2*capacity : 256;
+            *tests = (epd_test_t*)realloc(*tests,
+                    capacity*sizeof(epd_test_t));
+            assert(*tests);
         }
-        printf("%d: %s\t", total_tests+1, id);
-        if (best_move == NO_MOVE) {
+        parse_epd_test(line, &(*tests)[num_tests++]);
+    }
+    fclose(test_file);
+    return num_tests;
+}
+
+/*
+ * Search a single test position for the suite's time per problem.
+ */
+static void run_epd_test(search_data_t* data, epd_test_t* test)
+{
+    init_search_data(data);
+    set_position(&data->root_pos, test->fen);
+    if (!data->silent) print_board(&data->root_pos, false);
+    data->time_target = data->time_limit = suite.time_per_problem;
+    deepening_search(data, false);
+    test->result = data->pv[0];
+    test->time = elapsed_time(&data->timer);
+    test->solution_time = test->result == test->best_move ?
+        data->best_move_time : -1;
+}
+
+/*
+ * Print results for every finished test that hasn't been reported yet and
+ * doesn't follow an unfinished test. Called with the suite lock held.
+ */
+static void report_epd_tests(void)
+{
+    while (suite.next_report < suite.num_tests &&
+            suite.tests[suite.next_report].done) {
+        epd_test_t* test = &suite.tests[suite.next_report++];
+        printf("%d: %s\t", suite.next_report, test->id);
+        if (test->best_move == NO_MOVE) {
             printf("parse error: couldn't read best move\n");
-            test = test_storage;
-            ++total_tests;
             continue;
         }
-        bool failure = false;
-        start_timer(&epd_timer);
-        root_data.time_target = root_data.time_limit = time_per_problem;
-        deepening_search(&root_data, false);
-        move_t result = root_data.pv[0];
-        int time = stop_timer(&epd_timer);
-        if (result != best_move) {
-            failure = true;
-            printf("--");
-        } else printf("OK");
-        printf(" / %.2fs\n", time/1000.0);
-        ++total_tests;
-        if (!failure) ++correct_tests;
-        test = test_storage;
+        if (test->solution_time < 0) {
+            printf("-- / %.2fs\n", test->time/1000.0);
+            continue;
+        }
+        printf("OK / %.2fs / solved in %.2fs\n",
+                test->time/1000.0, test->solution_time/1000.0);
+        ++suite.correct_tests;
+        suite.solved_time += test->solution_time;
     }
-    printf("Tests completed. %d/%d tests passed in %.2fs.\n",
-            correct_tests, total_tests, elapsed_time(&epd_timer)/1000.0);
+    fflush(stdout);
 }
 
+/*
+ * Search tests from the suite until there are none left.
+ */
+static void epd_worker(search_data_t* data)
+{
+    while (true) {
+        lock_mutex(&suite.lock);
+        int index = suite.next_test++;
+        unlock_mutex(&suite.lock);
+        if (index >= suite.num_tests) break;
+        epd_test_t* test = &suite.tests[index];
+        if (test->best_move != NO_MOVE) run_epd_test(data, test);
+        lock_mutex(&suite.lock);
+        test->done = true;
+        report_epd_tests();
+        unlock_mutex(&suite.lock);
+    }
+}
+
+static THREAD_FN(epd_worker_thread, arg)
+{
+    epd_worker((search_data_t*)arg);
+    THREAD_RETURN;
+}
+
+/*
+ * Give |worker| its own hash tables and a silent search. The transposition
+ * table budget is split evenly between workers; the smaller tables are
+ * copied at full size.
+ */
+static void init_epd_worker(epd_worker_t* worker, int num_workers)
+{
+    size_t tt_bytes = transposition_table_bytes(&default_trans_table) /
+        num_workers;
+    init_transposition_table(&worker->trans_table, MAX(tt_bytes, 1<<20));
+    init_pawn_table(&worker->pawn_table,
+            default_pawn_table.num_buckets * sizeof(pawn_data_t));
+    init_material_table(&worker->material_table,
+            default_material_table.num_buckets * sizeof(material_data_t));
+    init_eval_table(&worker->eval_table,
+            default_eval_table.num_buckets * sizeof(eval_entry_t));
+    init_pv_cache(&worker->pv_cache,
+            default_pv_cache.num_buckets * sizeof(move_cache_t));
+    worker->data.trans_table = &worker->trans_table;
+    worker->data.pawn_table = &worker->pawn_table;
+    worker->data.material_table = &worker->material_table;
+    worker->data.eval_table = &worker->eval_table;
+    worker->data.pv_cache = &worker->pv_cache;
+    worker->data.silent = true;
+}
+
+static void destroy_epd_worker(epd_worker_t* worker)
+{
+    destroy_transposition_table(&worker->trans_table);
+    destroy_pawn_table(&worker->pawn_table);
+    destroy_material_table(&worker->material_table);
+    destroy_eval_table(&worker->eval_table);
+    destroy_pv_cache(&worker->pv_cache);
+}
+
+/*
+ * Search each position in an epd file for |time_per_problem| milliseconds
+ * and check the result against the best move given in the file. With more
+ * than one thread, positions are spread over a pool of independent silent
+ * searches, each with its own hash tables, and only the results are
+ * printed. Results are always reported in file order.
+ */
+void epd_testsuite(char* filename, int time_per_problem, int num_threads)
+{
+    milli_timer_t epd_timer;
+    init_timer(&epd_timer);
+    memset(&suite, 0, sizeof(suite));
+    suite.num_tests = read_epd_tests(filename, &suite.tests);
+    if (suite.num_tests < 0) return;
+    suite.time_per_problem = time_per_problem;
+    init_mutex(&suite.lock);
+    num_threads = CLAMP(num_threads, 1, MAX(suite.num_tests, 1));
+
+    start_timer(&epd_timer);
+    if (num_threads == 1) {
+        epd_worker(&root_data);
+    } else {
+        epd_worker_t* workers =
+            (epd_worker_t*)calloc(num_threads, sizeof(epd_worker_t));
+        assert(workers);
+        int num_workers = 0;
+        for (; num_workers<num_threads; ++num_workers) {
+            epd_worker_t* worker = &workers[num_workers];
+            init_epd_worker(worker, num_threads);
+            if (!create_thread(&worker->thread,
+                        epd_worker_thread, &worker->data)) {
+                warn("failed to create epd worker thread");
+                destroy_epd_worker(worker);
+                break;
+            }
+        }
+        // If no threads could be started, do the work ourselves.
+        if (!num_workers) epd_worker(&root_data);
+        for (int i=0; i<num_workers; ++i) {
+            join_thread(workers[i].thread);
+            destroy_epd_worker(&workers[i]);
+        }
+        free(workers);
+        num_threads = MAX(num_workers, 1);
+    }
+    int time = stop_timer(&epd_timer);
+
+    printf("Tests completed. %d/%d tests passed in %.2fs.\n",
+            suite.correct_tests, suite.num_tests, time/1000.0);
+    printf("%d threads, %.1f positions/hour", num_threads,
+            suite.num_tests * 3600000.0 / MAX(time, 1));
+    if (suite.correct_tests) {
+        printf(", average time to solution %.2fs",
+                suite.solved_time / 1000.0 / suite.correct_tests);
+    }
+    printf("\n");
+    destroy_mutex(&suite.lock);
+    free(suite.tests);
+}
@@ -1,5 +1,6 @@
 
 #include "daydreamer.h"
+#include <string.h>
 
 #include "pst.inc"
 
@@ -10,6 +11,17 @@
 
 static const int tempo_bonus[2] = { 9, 2 };
 
+// Bounds on the magnitude of the blended piece and king safety terms, used
+// to stop evaluation early when those terms can't affect a search decision.
+// These are a little above the largest values seen over the benchmark
+// positions (176 and 289), not strict limits. King safety is zero when
+// there are no queens on the board.
+static const int lazy_pieces_margin = 200;
+static const int lazy_safety_margin = 300;
+
+// The table used by the engine's own search.
+eval_table_t default_eval_table;
+
 /*
  * Initialize all static evaluation data structures.
  */
@@ -52,21 +64,113 @@ static int blend_score(score_t* score, int phase)
     return (phase*score->midgame + (MAX_PHASE-phase)*score->endgame)/MAX_PHASE;
 }
 
+/*
+ * Point |ed| at the pawn, material, and eval tables that evaluations using
+ * it should read from and fill in. A NULL |eval_table| disables caching of
+ * full evaluations.
+ */
+void init_eval_data(eval_data_t* ed,
+        pawn_table_t* pawn_table,
+        material_table_t* material_table,
+        eval_table_t* eval_table)
+{
+    ed->pd = NULL;
+    ed->md = NULL;
+    ed->pawn_table = pawn_table;
+    ed->material_table = material_table;
+    ed->eval_table = eval_table;
+}
+
+/*
+ * Create an eval cache that fills as much of |max_bytes| as possible.
+ */
+void init_eval_table(eval_table_t* et, const int max_bytes)
+{
+    assert(max_bytes >= 1024);
+    et->num_buckets = max_bytes / sizeof(eval_entry_t);
+    int size = et->num_buckets * sizeof(eval_entry_t);
+    alloc_table_memory(&et->memory, size,
+            options.large_pages ? TABLE_LARGE_PAGES : 0);
+    et->entries = (eval_entry_t*)et->memory.ptr;
+    assert(et->entries);
+    memset(&et->stats, 0, sizeof(et->stats));
+}
+
+/*
+ * Release the memory held by |et|.
+ */
+void destroy_eval_table(eval_table_t* et)
+{
+    free_table_memory(&et->memory);
+    et->entries = NULL;
+    et->num_buckets = 0;
+}
+
+/*
+ * Wipe the entire table.
+ */
+void clear_eval_table(eval_table_t* et)
+{
+    clear_table_memory(&et->memory);
+    memset(&et->stats, 0, sizeof(et->stats));
+}
+
+/*
+ * Look up the cache entry for the given position.
+ */
+static eval_entry_t* get_eval_entry(eval_table_t* et, const position_t* pos)
+{
+    eval_entry_t* entry = &et->entries[hash_index(pos->hash, et->num_buckets)];
+    if (entry->key == eval_key(pos->hash)) et->stats.hits++;
+    else if (entry->key != 0) et->stats.evictions++;
+    else {
+        et->stats.misses++;
+        et->stats.occupied++;
+    }
+    return entry;
+}
+
+/*
+ * Print stats about the eval cache.
+ */
+void print_eval_stats(eval_table_t* et)
+{
+    uint64_t probes = et->stats.hits + et->stats.misses + et->stats.evictions;
+    printf("info string eval cache entries %d", et->num_buckets);
+    printf(" filled %"PRIu64" (%.2f%%)", et->stats.occupied,
+            (float)et->stats.occupied / (float)et->num_buckets*100.);
+    printf(" evictions %"PRIu64, et->stats.evictions);
+    printf(" hits %"PRIu64" (%.2f%%)", et->stats.hits,
+            (float)et->stats.hits / MAX(probes, 1)*100.);
+    printf(" misses %"PRIu64" (%.2f%%)\n", et->stats.misses,
+            (float)et->stats.misses / MAX(probes, 1)*100.);
+
+    // Show where evaluations finished, to judge the lazy exit margins.
+    const char* labels[EVAL_NUM_EXITS] = { "cache", "pawns", "pieces", "full" };
+    uint64_t evals = 0;
+    for (int i=0; i<EVAL_NUM_EXITS; ++i) evals += et->stats.exits[i];
+    printf("info string eval exits");
+    for (int i=0; i<EVAL_NUM_EXITS; ++i) {
+        printf(" %s %"PRIu64" (%.2f%%)", labels[i], et->stats.exits[i],
+                (float)et->stats.exits[i] / MAX(evals, 1)*100.);
+    }
+    printf("\n");
+}
+
 /*
  * Perform a simple position evaluation based just on material and piece
  * square bonuses.
  */
-int simple_eval(const position_t* pos)
+int simple_eval(const position_t* pos, eval_data_t* ed)
 {
     color_t side = pos->side_to_move;
-    eval_data_t ed;
-    ed.md = get_material_data(pos);
+    ed->md = get_material_data(ed->material_table, pos);
 
     int score = 0;
-    int endgame_scale[2] = { ed.md->scale[WHITE], ed.md->scale[BLACK] };
+    int endgame_scale[2] = { ed->md->scale[WHITE], ed->md->scale[BLACK] };
     if (endgame_scale[WHITE]==0 && endgame_scale[BLACK]==0) return DRAW_VALUE;
 
-    score_t phase_score = ed.md->score;
+    score_t phase_score = ed->md->score;
     if (side == BLACK) {
         phase_score.midgame *= -1;
         phase_score.endgame *= -1;
@@ -79,7 +183,7 @@ int simple_eval(const position_t* pos)
     phase_score.midgame += tempo_bonus[0];
     phase_score.endgame += tempo_bonus[1];
 
-    score = blend_score(&phase_score, ed.md->phase);
+    score = blend_score(&phase_score, ed->md->phase);
     score = (score * endgame_scale[score > 0 ? side : side^1]) / 1024;
 
     if (!can_win(pos, side)) score = MIN(score, DRAW_VALUE);
@@ -88,17 +192,60 @@ int simple_eval(const position_t* pos)
 }
 
 /*
- * Do full, more expensive evaluation of the position.
+ * Apply endgame scaling and draw clamping to a blended score. This is
+ * monotonic in |score|, so it maps bounds on the unscaled score to bounds on
+ * the final evaluation.
  */
-int full_eval(const position_t* pos, eval_data_t* ed)
+static int scale_score(const position_t* pos, eval_data_t* ed, int score)
 {
     color_t side = pos->side_to_move;
-    score_t phase_score, component_score;
-    ed->md = get_material_data(pos);
+    score = (score * ed->md->scale[score > 0 ? side : side^1]) / 1024;
+    if (!can_win(pos, side)) score = MIN(score, DRAW_VALUE);
+    if (!can_win(pos, flip_color(side))) score = MAX(score, DRAW_VALUE);
+    return score;
+}
 
-    int score = 0;
-    int endgame_scale[2] = { ed->md->scale[WHITE], ed->md->scale[BLACK] };
-    if (endgame_scale[WHITE]==0 && endgame_scale[BLACK]==0) return DRAW_VALUE;
+/*
+ * Can the terms not yet added to the blended score |partial|, which are
+ * expected to total no more than |margin| in magnitude, bring the evaluation
+ * inside (alpha, beta)? If not, store the scaled partial score in
+ * |estimate|.
+ */
+static bool lazy_exit(const position_t* pos,
+        eval_data_t* ed,
+        int partial,
+        int margin,
+        int alpha,
+        int beta,
+        int* estimate)
+{
+    if (scale_score(pos, ed, partial + margin) <= alpha ||
+            scale_score(pos, ed, partial - margin) >= beta) {
+        *estimate = scale_score(pos, ed, partial);
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Do full, more expensive evaluation of the position. Terms are added from
+ * cheapest to most expensive, and evaluation stops as soon as the remaining
+ * terms are unlikely to bring the score inside (alpha, beta). In that case
+ * the result is the score of the terms computed so far, and the full
+ * evaluation usually lies on the same side of the window. |exit| records
+ * where evaluation stopped.
+ */
+static int compute_full_eval(const position_t* pos,
+        eval_data_t* ed,
+        int alpha,
+        int beta,
+        eval_exit_t* exit)
+{
+    color_t side = pos->side_to_move;
+    score_t phase_score, component_score;
+    ed->md = get_material_data(ed->material_table, pos);
+    *exit = EVAL_EXIT_FULL;
+    if (ed->md->scale[WHITE]==0 && ed->md->scale[BLACK]==0) return DRAW_VALUE;
 
     phase_score = ed->md->score;
     if (side == BLACK) {
@@ -109,24 +256,70 @@ int full_eval(const position_t* pos, eval_data_t* ed)
         pos->piece_square_eval[side^1].midgame;
     phase_score.endgame += pos->piece_square_eval[side].endgame -
         pos->piece_square_eval[side^1].endgame;
+    phase_score.midgame += tempo_bonus[0];
+    phase_score.endgame += tempo_bonus[1];
 
-    component_score = pawn_score(pos, &ed->pd);
+    component_score = pawn_score(ed->pawn_table, pos, &ed->pd);
     add_scaled_score(&phase_score, &component_score, pawn_scale);
     component_score = pattern_score(pos);
     add_scaled_score(&phase_score, &component_score, pattern_scale);
-    component_score = pieces_score(pos, ed->pd);
+
+    int safety_margin = pos->piece_count[WQ] || pos->piece_count[BQ] ?
+        lazy_safety_margin : 0;
+    int score;
+    if (lazy_exit(pos, ed, blend_score(&phase_score, ed->md->phase),
+                lazy_pieces_margin + safety_margin,
+                alpha, beta, &score)) {
+        *exit = EVAL_EXIT_PAWNS;
+        return score;
+    }
+    compute_attack_map(pos, ed);
+    component_score = pieces_score(pos, ed);
     add_scaled_score(&phase_score, &component_score, pieces_scale);
+
+    if (lazy_exit(pos, ed, blend_score(&phase_score, ed->md->phase),
+                safety_margin, alpha, beta, &score)) {
+        *exit = EVAL_EXIT_PIECES;
+        return score;
+    }
     component_score = evaluate_king_safety(pos, ed);
     add_scaled_score(&phase_score, &component_score, safety_scale);
 
-    phase_score.midgame += tempo_bonus[0];
-    phase_score.endgame += tempo_bonus[1];
+    return scale_score(pos, ed, blend_score(&phase_score, ed->md->phase));
+}
 
-    score = blend_score(&phase_score, ed->md->phase);
-    score = (score * endgame_scale[score > 0 ? side : side^1]) / 1024;
+/*
+ * Return the full evaluation of the position.
+ */
+int full_eval(const position_t* pos, eval_data_t* ed)
+{
+    return lazy_eval(pos, ed, -MATE_VALUE, MATE_VALUE);
+}
 
-    if (!can_win(pos, side)) score = MIN(score, DRAW_VALUE);
-    if (!can_win(pos, flip_color(side))) score = MAX(score, DRAW_VALUE);
+/*
+ * Evaluate the position, stopping early if the score looks likely to fall
+ * outside (alpha, beta). Scores strictly inside the window are exact; scores
+ * outside it are estimates, and the exact score is usually, but not always,
+ * outside it too. Only exact scores are cached, and the cached score is
+ * reused if this position has been evaluated before. On a cache hit, |ed|'s
+ * pawn and material data are left unset.
+ */
+int lazy_eval(const position_t* pos, eval_data_t* ed, int alpha, int beta)
+{
+    eval_exit_t exit;
+    eval_table_t* et = ed->eval_table;
+    if (!et) return compute_full_eval(pos, ed, alpha, beta, &exit);
+    eval_entry_t* entry = get_eval_entry(et, pos);
+    if (entry->key == eval_key(pos->hash)) {
+        et->stats.exits[EVAL_EXIT_CACHE]++;
+        return entry->score;
+    }
+    int score = compute_full_eval(pos, ed, alpha, beta, &exit);
+    et->stats.exits[exit]++;
+    if (exit == EVAL_EXIT_FULL) {
+        entry->key = eval_key(pos->hash);
+        entry->score = score;
+    }
     return score;
 }
 
@@ -137,9 +330,10 @@ void report_eval(const position_t* pos)
 {
     eval_data_t ed_storage;
     eval_data_t* ed = &ed_storage;
+    init_eval_data(ed, &default_pawn_table, &default_material_table, NULL);
     color_t side = pos->side_to_move;
     score_t phase_score, component_score;
-    ed->md = get_material_data(pos);
+    ed->md = get_material_data(ed->material_table, pos);
 
     int score = 0;
     int endgame_scale[2] = { ed->md->scale[WHITE], ed->md->scale[BLACK] };
@@ -157,13 +351,14 @@ void report_eval(const position_t* pos)
         pos->piece_square_eval[side^1].endgame;
     printf("psq_score\t(%5d, %5d)\n", phase_score.midgame, phase_score.endgame);
 
-    component_score = pawn_score(pos, &ed->pd);
+    component_score = pawn_score(ed->pawn_table, pos, &ed->pd);
     add_scaled_score(&phase_score, &component_score, pawn_scale);
     printf("pawn_score\t(%5d, %5d)\n", phase_score.midgame, phase_score.endgame);
     component_score = pattern_score(pos);
     add_scaled_score(&phase_score, &component_score, pattern_scale);
     printf("pattern_score\t(%5d, %5d)\n", phase_score.midgame, phase_score.endgame);
-    component_score = pieces_score(pos, ed->pd);
+    compute_attack_map(pos, ed);
+    component_score = pieces_score(pos, ed);
     add_scaled_score(&phase_score, &component_score, pieces_scale);
     printf("pieces_score\t(%5d, %5d)\n", phase_score.midgame, phase_score.endgame);
     component_score = evaluate_king_safety(pos, ed);
@@ -75,9 +75,97 @@ typedef struct {
     color_t strong_side;
 } material_data_t;
 
+typedef struct {
+    pawn_data_t* entries;
+    table_memory_t memory;
+    int num_buckets;
+    struct {
+        int misses;
+        int hits;
+        int occupied;
+        int evictions;
+    } stats;
+} pawn_table_t;
+
+typedef struct {
+    material_data_t* entries;
+    table_memory_t memory;
+    int num_buckets;
+    struct {
+        int misses;
+        int hits;
+        int occupied;
+        int evictions;
+    } stats;
+} material_table_t;
+
+// A cached full evaluation. The entry is chosen by the upper bits of the
+// position's hash and verified against the lower 32 bits, so unrelated
+// positions can occasionally collide; the cache is lossy and never cleared
+// except when it's resized. Each search thread has its own cache.
+typedef struct {
+    uint32_t key;
+    int32_t score;
+} eval_entry_t;
+
+// The points at which an evaluation can finish: a cache hit, a lazy exit
+// after the pawn and pattern terms or after the piece terms, or a complete
+// evaluation.
+typedef enum {
+    EVAL_EXIT_CACHE,
+    EVAL_EXIT_PAWNS,
+    EVAL_EXIT_PIECES,
+    EVAL_EXIT_FULL,
+    EVAL_NUM_EXITS
+} eval_exit_t;
+
+typedef struct {
+    eval_entry_t* entries;
+    table_memory_t memory;
+    int num_buckets;
+    struct {
+        uint64_t misses;
+        uint64_t hits;
+        uint64_t occupied;
+        uint64_t evictions;
+        uint64_t exits[EVAL_NUM_EXITS];
+    } stats;
+} eval_table_t;
+
+#define eval_key(hash)      ((uint32_t)(hash))
+
+#define prefetch_pawn_data(pt, hash)    \
+    prefetch_address(&(pt)->entries[hash_index(hash, (pt)->num_buckets)])
+#define prefetch_material_data(mt, hash)    \
+    prefetch_address(&(mt)->entries[hash_index(hash, (mt)->num_buckets)])
+#define prefetch_eval_entry(et, hash)    \
+    prefetch_address(&(et)->entries[hash_index(hash, (et)->num_buckets)])
+
+extern pawn_table_t default_pawn_table;
+extern material_table_t default_material_table;
+extern eval_table_t default_eval_table;
+
+// Squares attacked by each side, computed once per evaluation and shared by
+// the piece and king safety terms. |piece_attacks| is indexed in parallel
+// with pos->pieces, and |by_type| by piece type. The king zone is the set of
+// squares adjacent to a king, and |king_attackers| counts the pieces (not
+// pawns or the king) that attack the other side's king zone.
+typedef struct {
+    bitboard_t occupied[2];
+    bitboard_t piece_attacks[2][32];
+    bitboard_t by_type[2][KING+1];
+    bitboard_t all[2];
+    bitboard_t king_zone[2];
+    int king_attackers[2];
+} attack_map_t;
+
 typedef struct {
     pawn_data_t* pd;
     material_data_t* md;
+    attack_map_t attacks;
+    pawn_table_t* pawn_table;
+    material_table_t* material_table;
+    eval_table_t* eval_table;
 } eval_data_t;
 
 typedef void(*eg_scale_fn)(const position_t*, eval_data_t*, int scale[2]);
@@ -0,0 +1,40 @@
+
+#include "daydreamer.h"
+#include <string.h>
+
+/*
+ * Fill in |ed->attacks| for |pos|.
+ */
+void compute_attack_map(const position_t* pos, eval_data_t* ed)
+{
+    attack_map_t* am = &ed->attacks;
+    bitboard_t occupied = occupied_squares(pos);
+    memset(am->by_type, 0, sizeof(am->by_type));
+    for (color_t side=WHITE; side<=BLACK; ++side) {
+        am->occupied[side] = pos->color_bb[side];
+        am->king_zone[side] =
+            king_attacks[square_to_index(pos->pieces[side][0])];
+        am->by_type[side][KING] = am->king_zone[side];
+    }
+
+    bitboard_t pawns = pos->piece_bb[WP];
+    am->by_type[WHITE][PAWN] =
+        ((pawns & ~FILE_A_BB) << 7) | ((pawns & ~FILE_H_BB) << 9);
+    pawns = pos->piece_bb[BP];
+    am->by_type[BLACK][PAWN] =
+        ((pawns & ~FILE_A_BB) >> 9) | ((pawns & ~FILE_H_BB) >> 7);
+
+    for (color_t side=WHITE; side<=BLACK; ++side) {
+        am->king_attackers[side] = 0;
+        am->all[side] = am->by_type[side][PAWN] | am->by_type[side][KING];
+        for (int i=1; i<pos->num_pieces[side]; ++i) {
+            square_t from = pos->pieces[side][i];
+            bitboard_t attacks = attacks_from(pos->board[from],
+                    square_to_index(from), occupied);
+            am->piece_attacks[side][i] = attacks;
+            am->by_type[side][piece_type(pos->board[from])] |= attacks;
+            am->all[side] |= attacks;
+            if (attacks & am->king_zone[side^1]) am->king_attackers[side]++;
+        }
+    }
+}
@@ -6,6 +6,7 @@
 
 static void evaluate_king_shield(const position_t* pos, int score[2]);
 static void evaluate_king_attackers(const position_t* pos,
+        const attack_map_t* am,
         int shield_score[2],
         int score[2]);
 
@@ -22,13 +23,17 @@ const int num_king_attack_scale[16] = {
     1344, 1344, 1408, 1408, 1472, 1472, 1536, 1536
 };
 
+/*
+ * Score the safety of each king, from the pawns sheltering it and the pieces
+ * attacking the squares around it. Attacks are read from the attack map in
+ * |ed|, which must already be computed.
+ */
 score_t evaluate_king_safety(const position_t* pos, eval_data_t* ed)
 {
-    (void)ed;
     int shield_score[2], attack_score[2];
 
     evaluate_king_shield(pos, shield_score);
-    evaluate_king_attackers(pos, shield_score, attack_score);
+    evaluate_king_attackers(pos, &ed->attacks, shield_score, attack_score);
 
     score_t phase_score;
     color_t side = pos->side_to_move;
@@ -99,6 +104,7 @@ static void evaluate_king_shield(const position_t* pos, int score[2])
  * attacking a square adjacent to the king.
  */
 static void evaluate_king_attackers(const position_t* pos,
+        const attack_map_t* am,
         int shield_score[2],
         int score[2])
 {
@@ -106,13 +112,11 @@ static void evaluate_king_attackers(const position_t* pos,
     for (color_t side = WHITE; side <= BLACK; ++side) {
         score[side] = 0;
         if (pos->piece_count[create_piece(side, QUEEN)] == 0) continue;
-        const square_t opp_king = pos->pieces[side^1][0];
-        int num_attackers = 0;
-        for (int i=1; i<pos->num_pieces[side]; ++i) {
-            const square_t attacker = pos->pieces[side][i];
-            if (piece_attacks_near(pos, attacker, opp_king)) {
-                score[side] += king_attack_score[pos->board[attacker]];
-                num_attackers++;
+        int num_attackers = am->king_attackers[side];
+        for (int i=1; num_attackers && i<pos->num_pieces[side]; ++i) {
+            if (am->piece_attacks[side][i] & am->king_zone[side^1]) {
+                score[side] +=
+                    king_attack_score[pos->board[pos->pieces[side][i]]];
             }
         }
         if (shield_score[side^1] <= bad_shield) num_attackers += 2;
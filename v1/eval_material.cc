@@ -2,58 +2,61 @@
 #include "daydreamer.h"
 #include <string.h>
 
-static material_data_t* material_table = NULL;
 static void compute_material_data(const position_t* pos, material_data_t* md);
 
-static int num_buckets;
-static struct {
-    int misses;
-    int hits;
-    int occupied;
-    int evictions;
-} material_hash_stats;
+// The table used by the engine's own search.
+material_table_t default_material_table;
 
 /*
- * Create a material hash table of the appropriate size.
+ * Create a material hash table that fills as much of |max_bytes| as possible.
  */
-void init_material_table(const int max_bytes)
+void init_material_table(material_table_t* mt, const int max_bytes)
 {
     assert(max_bytes >= 1024);
-    int size = sizeof(material_data_t);
-    num_buckets = 1;
-    while (size <= max_bytes >> 1) {
-        size <<= 1;
-        num_buckets <<= 1;
-    }
-    if (material_table != NULL) free(material_table);
-    material_table = (material_data_t*)malloc(size);
-    assert(material_table);
-    clear_material_table();
+    mt->num_buckets = max_bytes / sizeof(material_data_t);
+    int size = mt->num_buckets * sizeof(material_data_t);
+    alloc_table_memory(&mt->memory, size,
+            options.large_pages ? TABLE_LARGE_PAGES : 0);
+    mt->entries = (material_data_t*)mt->memory.ptr;
+    assert(mt->entries);
+    memset(&mt->stats, 0, sizeof(mt->stats));
+}
+
+/*
+ * Release the memory held by |mt|.
+ */
+void destroy_material_table(material_table_t* mt)
+{
+    free_table_memory(&mt->memory);
+    mt->entries = NULL;
+    mt->num_buckets = 0;
 }
 
 /*
  * Wipe the entire table.
  */
-void clear_material_table(void)
+void clear_material_table(material_table_t* mt)
 {
-    memset(material_table, 0, sizeof(material_data_t) * num_buckets);
-    memset(&material_hash_stats, 0, sizeof(material_hash_stats));
+    clear_table_memory(&mt->memory);
+    memset(&mt->stats, 0, sizeof(mt->stats));
 }
 
 /*
  * Look up the material data for the given position.
  */
-material_data_t* get_material_data(const position_t* pos)
+material_data_t* get_material_data(material_table_t* mt,
+        const position_t* pos)
 {
-    material_data_t* md = &material_table[pos->material_hash % num_buckets];
+    material_data_t* md =
+        &mt->entries[hash_index(pos->material_hash, mt->num_buckets)];
     if (md->key == pos->material_hash) {
-        material_hash_stats.hits++;
+        mt->stats.hits++;
         return md;
     } else if (md->key != 0) {
-        material_hash_stats.evictions++;
+        mt->stats.evictions++;
     } else {
-        material_hash_stats.misses++;
-        material_hash_stats.occupied++;
+        mt->stats.misses++;
+        mt->stats.occupied++;
     }
     compute_material_data(pos, md);
     md->key = pos->material_hash;
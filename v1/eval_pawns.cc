@@ -72,53 +72,54 @@ static const int central_space[0x80] = {
     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
 };
 
-static pawn_data_t* pawn_table = NULL;
-static int num_buckets;
-static struct {
-    int misses;
-    int hits;
-    int occupied;
-    int evictions;
-} pawn_hash_stats;
+// The table used by the engine's own search.
+pawn_table_t default_pawn_table;
 
 /*
- * Create a pawn hash table of the appropriate size.
+ * Create a pawn hash table that fills as much of |max_bytes| as possible.
  */
-void init_pawn_table(const int max_bytes)
+void init_pawn_table(pawn_table_t* pt, const int max_bytes)
 {
     assert(max_bytes >= 1024);
-    int size = sizeof(pawn_data_t);
-    num_buckets = 1;
-    while (size <= max_bytes >> 1) {
-        size <<= 1;
-        num_buckets <<= 1;
-    }
-    if (pawn_table != NULL) free(pawn_table);
-    pawn_table = (pawn_data_t*)malloc(size);
-    assert(pawn_table);
-    clear_pawn_table();
+    pt->num_buckets = max_bytes / sizeof(pawn_data_t);
+    int size = pt->num_buckets * sizeof(pawn_data_t);
+    alloc_table_memory(&pt->memory, size,
+            options.large_pages ? TABLE_LARGE_PAGES : 0);
+    pt->entries = (pawn_data_t*)pt->memory.ptr;
+    assert(pt->entries);
+    memset(&pt->stats, 0, sizeof(pt->stats));
+}
+
+/*
+ * Release the memory held by |pt|.
+ */
+void destroy_pawn_table(pawn_table_t* pt)
+{
+    free_table_memory(&pt->memory);
+    pt->entries = NULL;
+    pt->num_buckets = 0;
 }
 
 /*
  * Wipe the entire table.
  */
-void clear_pawn_table(void)
+void clear_pawn_table(pawn_table_t* pt)
 {
-    memset(pawn_table, 0, sizeof(pawn_data_t) * num_buckets);
-    memset(&pawn_hash_stats, 0, sizeof(pawn_hash_stats));
+    clear_table_memory(&pt->memory);
+    memset(&pt->stats, 0, sizeof(pt->stats));
 }
 
 /*
  * Look up the pawn data for the pawns in the given position.
  */
-static pawn_data_t* get_pawn_data(const position_t* pos)
+static pawn_data_t* get_pawn_data(pawn_table_t* pt, const position_t* pos)
 {
-    pawn_data_t* pd = &pawn_table[pos->pawn_hash % num_buckets];
-    if (pd->key == pos->pawn_hash) pawn_hash_stats.hits++;
-    else if (pd->key != 0) pawn_hash_stats.evictions++;
+    pawn_data_t* pd = &pt->entries[hash_index(pos->pawn_hash, pt->num_buckets)];
+    if (pd->key == pos->pawn_hash) pt->stats.hits++;
+    else if (pd->key != 0) pt->stats.evictions++;
     else {
-        pawn_hash_stats.misses++;
-        pawn_hash_stats.occupied++;
+        pt->stats.misses++;
+        pt->stats.occupied++;
     }
     return pd;
 }
@@ -126,18 +127,18 @@ static pawn_data_t* get_pawn_data(const position_t* pos)
 /*
  * Print stats about the pawn hash.
  */
-void print_pawn_stats(void)
+void print_pawn_stats(pawn_table_t* pt)
 {
-    printf("info string pawn hash entries %d", num_buckets);
-    printf(" filled %d (%.2f%%)", pawn_hash_stats.occupied,
-            (float)pawn_hash_stats.occupied / (float)num_buckets*100.);
-    printf(" evictions %d", pawn_hash_stats.evictions);
-    printf(" hits %d (%.2f%%)", pawn_hash_stats.hits,
-            (float)pawn_hash_stats.hits /
-            (pawn_hash_stats.hits + pawn_hash_stats.misses)*100.);
-    printf(" misses %d (%.2f%%)\n", pawn_hash_stats.misses,
-            (float)pawn_hash_stats.misses /
-            (pawn_hash_stats.hits + pawn_hash_stats.misses)*100.);
+    printf("info string pawn hash entries %d", pt->num_buckets);
+    printf(" filled %d (%.2f%%)", pt->stats.occupied,
+            (float)pt->stats.occupied / (float)pt->num_buckets*100.);
+    printf(" evictions %d", pt->stats.evictions);
+    printf(" hits %d (%.2f%%)", pt->stats.hits,
+            (float)pt->stats.hits /
+            (pt->stats.hits + pt->stats.misses)*100.);
+    printf(" misses %d (%.2f%%)\n", pt->stats.misses,
+            (float)pt->stats.misses /
+            (pt->stats.hits + pt->stats.misses)*100.);
 }
 
 /*
@@ -146,20 +147,17 @@ void print_pawn_stats(void)
  * score (which does not account for passers). This information is stored in
  * the pawn hash table, to prevent re-computation.
  */
-pawn_data_t* analyze_pawns(const position_t* pos)
+pawn_data_t* analyze_pawns(pawn_table_t* pt, const position_t* pos)
 {
-    pawn_data_t* pd = get_pawn_data(pos);
+    pawn_data_t* pd = get_pawn_data(pt, pos);
     if (pd->key == pos->pawn_hash) return pd;
 
-    // Zero everything out and create pawn bitboards.
+    // Zero everything out and copy the pawn bitboards.
     memset(pd, 0, sizeof(pawn_data_t));
     pd->key = pos->pawn_hash;
     square_t sq, to;
-    for (color_t color=WHITE; color<=BLACK; ++color) {
-        for (int i=0; pos->pawns[color][i] != INVALID_SQUARE; ++i) {
-            set_sq_bit(pd->pawns_bb[color], pos->pawns[color][i]);
-        }
-    }
+    pd->pawns_bb[WHITE] = pos->piece_bb[WP];
+    pd->pawns_bb[BLACK] = pos->piece_bb[BP];
 
     // Create outpost bitboard and analyze pawns.
     for (color_t color=WHITE; color<=BLACK; ++color) {
@@ -303,9 +301,11 @@ pawn_data_t* analyze_pawns(const position_t* pos)
  * and use it to determine the overall pawn score for the given position. The
  * pawn data is also used as an input to other evaluation functions.
  */
-score_t pawn_score(const position_t* pos, pawn_data_t** pawn_data)
+score_t pawn_score(pawn_table_t* pt,
+        const position_t* pos,
+        pawn_data_t** pawn_data)
 {
-    pawn_data_t* pd = analyze_pawns(pos);
+    pawn_data_t* pd = analyze_pawns(pt, pos);
     if (pawn_data) *pawn_data = pd;
     int passer_bonus[2] = {0, 0};
     int eg_passer_bonus[2] = {0, 0};
@@ -24,11 +24,6 @@ static const int mobility_score_table[2][8][32] = {
     },
 };
 
-static const int color_table[2][17] = {
-    {1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 0, 0}, // white
-    {1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, // black
-};
-
 static const int knight_outpost[0x80] = {
     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
@@ -61,16 +56,17 @@ static const int rook_half_open_file_bonus[2] = { 10, 10 };
  * defended by a friendly pawn and for being difficult to take with an
  * opponent's minor piece.
  */
-static int outpost_score(const position_t* pos, square_t sq, piece_type_t type)
+static int outpost_score(const position_t* pos,
+        const attack_map_t* am,
+        square_t sq,
+        piece_type_t type)
 {
     color_t side = piece_color(pos->board[sq]);
     int bonus = type == KNIGHT ? knight_outpost[sq ^ (0x70*side)] : bishop_outpost[sq ^ (0x70*side)];
     int score = bonus;
     if (bonus) {
         // An outpost is better when supported by pawns.
-        piece_t our_pawn = create_piece(side, PAWN);
-        if (pos->board[sq - pawn_push[side] - 1] == our_pawn ||
-                pos->board[sq - pawn_push[side] + 1] == our_pawn) {
+        if (sq_bit_is_set(am->by_type[side][PAWN], sq)) {
             score += bonus/2;
             // Even better if an opposing knight/bishop can't capture it.
             // TODO: take care of the case where there's one opposing bishop
@@ -91,69 +87,41 @@ static int outpost_score(const position_t* pos, square_t sq, piece_type_t type)
 /*
  * Compute the number of squares each non-pawn, non-king piece could move to,
  * and assign a bonus or penalty accordingly. Also assign miscellaneous
- * bonuses based on outpost squares, open files, etc.
+ * bonuses based on outpost squares, open files, etc. Attacks are read from
+ * the attack map in |ed|, which must already be computed.
  */
-score_t pieces_score(const position_t* pos, pawn_data_t* pd)
+score_t pieces_score(const position_t* pos, eval_data_t* ed)
 {
     score_t score;
     int mid_score[2] = {0, 0};
     int end_score[2] = {0, 0};
+    pawn_data_t* pd = ed->pd;
+    const attack_map_t* am = &ed->attacks;
     rank_t king_rank[2] = { relative_rank[WHITE]
                                 [square_rank(pos->pieces[WHITE][0])],
                             relative_rank[BLACK]
                                 [square_rank(pos->pieces[BLACK][0])] };
     color_t side;
     for (side=WHITE; side<=BLACK; ++side) {
-        const int* mobile = color_table[side];
-        square_t from, to;
+        square_t from;
         piece_t piece;
         for (int i=1; pos->pieces[side][i] != INVALID_SQUARE; ++i) {
             from = pos->pieces[side][i];
             piece = pos->board[from];
             piece_type_t type = piece_type(piece);
-            int ps = 0;
+            // Mobility counts empty squares and enemy pieces attacked.
+            int ps = popcount(am->piece_attacks[side][i] & ~am->occupied[side]);
             switch (type) {
-                case KNIGHT: {
-                    ps += mobile[pos->board[from-33]];
-                    ps += mobile[pos->board[from-31]];
-                    ps += mobile[pos->board[from-18]];
-                    ps += mobile[pos->board[from-14]];
-                    ps += mobile[pos->board[from+14]];
-                    ps += mobile[pos->board[from+18]];
-                    ps += mobile[pos->board[from+31]];
-                    ps += mobile[pos->board[from+33]];
-                    if (square_is_outpost(pd, from, side)) {
-                        int bonus = outpost_score(pos, from, KNIGHT);
-                        mid_score[side] += bonus;
-                        end_score[side] += bonus;
-                    }
-                    break;
-                }
+                case KNIGHT:
                 case BISHOP: {
-                    for (to=from-17; pos->board[to]==EMPTY; to-=17, ++ps) {}
-                    ps += mobile[pos->board[to]];
-                    for (to=from-15; pos->board[to]==EMPTY; to-=15, ++ps) {}
-                    ps += mobile[pos->board[to]];
-                    for (to=from+15; pos->board[to]==EMPTY; to+=15, ++ps) {}
-                    ps += mobile[pos->board[to]];
-                    for (to=from+17; pos->board[to]==EMPTY; to+=17, ++ps) {}
-                    ps += mobile[pos->board[to]];
                     if (square_is_outpost(pd, from, side)) {
-                        int bonus = outpost_score(pos, from, BISHOP);
+                        int bonus = outpost_score(pos, am, from, type);
                         mid_score[side] += bonus;
                         end_score[side] += bonus;
                     }
                     break;
                 }
                 case ROOK: {
-                    for (to=from-16; pos->board[to]==EMPTY; to-=16, ++ps) {}
-                    ps += mobile[pos->board[to]];
-                    for (to=from-1; pos->board[to]==EMPTY; to-=1, ++ps) {}
-                    ps += mobile[pos->board[to]];
-                    for (to=from+1; pos->board[to]==EMPTY; to+=1, ++ps) {}
-                    ps += mobile[pos->board[to]];
-                    for (to=from+16; pos->board[to]==EMPTY; to+=16, ++ps) {}
-                    ps += mobile[pos->board[to]];
                     int rrank = relative_rank[side][square_rank(from)];
                     if (rrank == RANK_7 && king_rank[side^1] == RANK_8) {
                         mid_score[side] += rook_on_7[0];
@@ -171,22 +139,6 @@ score_t pieces_score(const position_t* pos, pawn_data_t* pd)
                     break;
                 }
                 case QUEEN: {
-                    for (to=from-17; pos->board[to]==EMPTY; to-=17, ++ps) {}
-                    ps += mobile[pos->board[to]];
-                    for (to=from-15; pos->board[to]==EMPTY; to-=15, ++ps) {}
-                    ps += mobile[pos->board[to]];
-                    for (to=from+15; pos->board[to]==EMPTY; to+=15, ++ps) {}
-                    ps += mobile[pos->board[to]];
-                    for (to=from+17; pos->board[to]==EMPTY; to+=17, ++ps) {}
-                    ps += mobile[pos->board[to]];
-                    for (to=from-16; pos->board[to]==EMPTY; to-=16, ++ps) {}
-                    ps += mobile[pos->board[to]];
-                    for (to=from-1; pos->board[to]==EMPTY; to-=1, ++ps) {}
-                    ps += mobile[pos->board[to]];
-                    for (to=from+1; pos->board[to]==EMPTY; to+=1, ++ps) {}
-                    ps += mobile[pos->board[to]];
-                    for (to=from+16; pos->board[to]==EMPTY; to+=16, ++ps) {}
-                    ps += mobile[pos->board[to]];
                     if (relative_rank[side][square_rank(from)] == RANK_7 &&
                             king_rank[side^1] == RANK_8) {
                         mid_score[side] += rook_on_7[0] / 2;
@@ -210,4 +162,3 @@ score_t pieces_score(const position_t* pos, pawn_data_t* pd)
     score.endgame = end_score[side] - end_score[side^1];
     return score;
 }
-
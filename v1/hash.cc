@@ -37,6 +37,30 @@ void init_hash(void)
     for (i=0; i<2*2*2; ++i) _castle_random[i] = random_hashkey();
 }
 
+/*
+ * A fingerprint of the Zobrist keys, used to make sure that saved hash
+ * tables were built with the same keys we're using now. Every key goes into
+ * the fingerprint, along with the hash of a position that exercises the
+ * side to move, castling, and en passant terms.
+ */
+hashkey_t hash_signature(void)
+{
+    hashkey_t sig = 0;
+    const hashkey_t* keys[3] = {
+        &piece_random[0][0][0], &castle_random[0][0][0], &enpassant_random[0]
+    };
+    const int num_keys[3] = { 2*7*64, 2*2*2, 64 };
+    for (int i=0; i<3; ++i) {
+        for (int j=0; j<num_keys[i]; ++j) {
+            sig = (sig ^ keys[i][j]) * 0x9e3779b97f4a7c15ull;
+        }
+    }
+    position_t pos;
+    set_position(&pos,
+            "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+    return sig ^ pos.hash;
+}
+
 /*
  * Calculate the hash of a position from scratch. Used to in |set_position|,
  * and to verify the correctness of incremental hash updates in debug mode.
@@ -24,6 +24,22 @@ extern hashkey_t enpassant_random[64];
 #define material_hash(p,count) \
     piece_random[piece_color(p)][piece_type(p)][count]
 
+// Map a hash key onto [0, n) by taking the high half of the fixed point
+// product key * n. This lets hash tables have any number of buckets and
+// avoids a division on every probe. The bucket is chosen mostly by the high
+// bits of the key, so tables that store a partial key for verification
+// should store the low bits.
+#if defined(__SIZEOF_INT128__)
+#define hash_index(key, n) \
+    ((size_t)(((unsigned __int128)(key) * (uint64_t)(n)) >> 64))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#define hash_index(key, n)  ((size_t)__umulh((key), (uint64_t)(n)))
+#else
+#define hash_index(key, n) \
+    ((size_t)(((uint64_t)(uint32_t)((key) >> 32) * (uint64_t)(n)) >> 32))
+#endif
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
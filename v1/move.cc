@@ -18,6 +18,8 @@ void place_piece(position_t* pos, piece_t piece, square_t square)
     assert(square != INVALID_SQUARE);
 
     pos->board[square] = piece;
+    set_sq_bit(pos->piece_bb[piece], square);
+    set_sq_bit(pos->color_bb[color], square);
     if (piece_is_type(piece, PAWN)) {
         int index = pos->num_pawns[color]++;
         pos->pawns[color][index] = square;
@@ -71,6 +73,8 @@ void remove_piece(position_t* pos, square_t square)
         }
     }
     pos->board[square] = EMPTY;
+    clear_sq_bit(pos->piece_bb[piece], square);
+    clear_sq_bit(pos->color_bb[color], square);
     pos->piece_index[square] = -1;
     pos->piece_count[piece]--;
     pos->hash ^= piece_hash(piece, square);
@@ -98,6 +102,10 @@ void transfer_piece(position_t* pos, square_t from, square_t to)
     int index = pos->piece_index[to] = pos->piece_index[from];
     color_t color = piece_color(p);
     pos->board[from] = EMPTY;
+    bitboard_t move_bb = set_mask[square_to_index(from)] |
+        set_mask[square_to_index(to)];
+    pos->piece_bb[p] ^= move_bb;
+    pos->color_bb[color] ^= move_bb;
     if (piece_is_type(p, PAWN)) {
         pos->pawns[color][index] = to;
         pos->piece_index[to] = index;
@@ -200,7 +208,8 @@ void do_move(position_t* pos, move_t move, undo_info_t* undo)
     pos->hash_history[pos->ply++] = undo->hash;
     assert(pos->ply <= HASH_HISTORY_LENGTH);
     pos->side_to_move = flip_color(pos->side_to_move);
-    pos->is_check = find_checks(pos);
+    pos->is_check = find_move_checks(pos, move);
+    check_move_checks(pos);
     pos->prev_move = move;
     pos->hash ^= ep_hash(pos);
     pos->hash ^= castle_hash(pos);
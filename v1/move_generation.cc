@@ -39,6 +39,9 @@ static move_t* add_move(const position_t* pos,
 int generate_legal_moves(position_t* pos, move_t* moves)
 {
     if (is_check(pos)) return generate_evasions(pos, moves);
+    if (options.bitboard_movegen) {
+        return generate_bitboard_legal_moves(pos, moves);
+    }
     int num_pseudo = generate_pseudo_moves(pos, moves);
     move_t* moves_tail = moves+num_pseudo;
     move_t* moves_curr = moves;
@@ -60,6 +63,9 @@ int generate_legal_moves(position_t* pos, move_t* moves)
  */
 int generate_pseudo_tactical_moves(const position_t* pos, move_t* moves)
 {
+    if (options.bitboard_movegen) {
+        return generate_bitboard_tactical_moves(pos, moves);
+    }
     move_t* moves_head = moves;
     moves += generate_promotions(pos, moves);
     moves += generate_pseudo_captures(pos, moves);
@@ -119,14 +125,12 @@ static int generate_pseudo_captures(const position_t* pos, move_t* moves)
 }
 
 /*
- * Generate pseudo-legal moves which are neither captures nor promotions.
+ * Generate pseudo-legal castling moves. Shared by both move generators.
  */
-int generate_pseudo_quiet_moves(const position_t* pos, move_t* moves)
+int generate_castles(const position_t* pos, move_t* moves)
 {
     move_t* moves_head = moves;
     color_t side = pos->side_to_move;
-    piece_t piece;
-    square_t from;
 
     // Castling. Castles are considered pseudo-legal if we have appropriate
     // castling rights, the squares between king and rook are unoccupied,
@@ -229,7 +233,24 @@ int generate_pseudo_quiet_moves(const position_t* pos, move_t* moves)
                     moves);
         }
     }
+    *moves = 0;
+    return moves-moves_head;
+}
 
+/*
+ * Generate pseudo-legal moves which are neither captures nor promotions.
+ */
+int generate_pseudo_quiet_moves(const position_t* pos, move_t* moves)
+{
+    if (options.bitboard_movegen) {
+        return generate_bitboard_quiet_moves(pos, moves);
+    }
+    move_t* moves_head = moves;
+    color_t side = pos->side_to_move;
+    piece_t piece;
+    square_t from;
+
+    moves += generate_castles(pos, moves);
     for (int i = 0; i < pos->num_pieces[side]; ++i) {
         from = pos->pieces[side][i];
         piece = pos->board[from];
@@ -278,6 +299,7 @@ static int generate_promotions(const position_t* pos, move_t* moves)
 int generate_evasions(const position_t* pos, move_t* moves)
 {
     assert(pos->is_check && pos->board[pos->check_square]);
+    if (options.bitboard_movegen) return generate_bitboard_evasions(pos, moves);
     move_t* moves_head = moves;
     color_t side = pos->side_to_move;
     color_t other_side = flip_color(side);
@@ -290,7 +312,9 @@ int generate_evasions(const position_t* pos, move_t* moves)
     // Don't let the king mask its possible destination squares in calls
     // to is_square_attacked.
     square_t from = king_sq, to = INVALID_SQUARE;
+    bitboard_t king_bb = set_mask[square_to_index(king_sq)];
     ((position_t*)pos)->board[king_sq] = EMPTY;
+    ((position_t*)pos)->color_bb[side] ^= king_bb;
     for (const direction_t* delta = piece_deltas[king]; *delta; ++delta) {
         to = from + *delta;
         piece_t capture = pos->board[to];
@@ -301,6 +325,7 @@ int generate_evasions(const position_t* pos, move_t* moves)
         ((position_t*)pos)->board[king_sq] = EMPTY;
     }
     ((position_t*)pos)->board[king_sq] = king;
+    ((position_t*)pos)->color_bb[side] ^= king_bb;
     // If there are multiple checkers, only king moves are possible.
     if (pos->is_check > 1) {
         *moves = 0;
@@ -464,6 +489,7 @@ int generate_evasions(const position_t* pos, move_t* moves)
  */
 int generate_pseudo_checks(const position_t* pos, move_t* moves)
 {
+    if (options.bitboard_movegen) return generate_bitboard_checks(pos, moves);
     move_t* moves_head = moves;
     color_t side = pos->side_to_move;
     color_t other_side = flip_color(side);
@@ -488,6 +514,7 @@ int generate_pseudo_checks(const position_t* pos, move_t* moves)
                 for (sq = from-king_dir; pos->board[sq] == EMPTY;
                         sq -= king_dir) {}
                 if (side == piece_color(pos->board[sq]) &&
+                        piece_slide_type(pos->board[sq]) != NO_SLIDE &&
                         (king_atk->possible_attackers &
                          get_piece_flag(pos->board[sq]))) {
                     discover_check_dir = king_dir;
@@ -543,6 +570,7 @@ int generate_pseudo_checks(const position_t* pos, move_t* moves)
                 for (sq = from - king_dir; pos->board[sq] == EMPTY;
                         sq -= king_dir) {}
                 if (side == piece_color(pos->board[sq]) &&
+                        piece_slide_type(pos->board[sq]) != NO_SLIDE &&
                         (king_atk->possible_attackers &
                          get_piece_flag(pos->board[sq]))) {
                     discover_check_dir = king_dir;
@@ -550,13 +578,16 @@ int generate_pseudo_checks(const position_t* pos, move_t* moves)
             }
         }
         // Generate checking moves.
-        if (piece_is_type(piece, KNIGHT)) {
+        if (piece_slide_type(piece) == NO_SLIDE) {
+            // Knights and kings. A king can only discover check.
             for (const direction_t* delta = piece_deltas[piece];
                     *delta; ++delta) {
                 to = from + *delta;
                 if (pos->board[to] != EMPTY) continue;
-                if (discover_check_dir ||
-                        possible_attack(to, king_sq, WN)) {
+                will_discover_check = discover_check_dir &&
+                    abs(discover_check_dir) != abs(*delta);
+                if (will_discover_check || (piece_is_type(piece, KNIGHT) &&
+                            possible_attack(to, king_sq, piece))) {
                     moves = add_move(pos,
                             create_move(from, to, piece, EMPTY),
                             moves);
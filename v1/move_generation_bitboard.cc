@@ -0,0 +1,319 @@
+
+#include "daydreamer.h"
+
+// Pawn moves are generated a whole set at a time by shifting the pawn
+// bitboard, so these all depend on the side to move.
+#define pawn_push_bb(bb, side) \
+    ((side) == WHITE ? (bb) << 8 : (bb) >> 8)
+#define pawn_left_bb(bb, side) \
+    ((side) == WHITE ? ((bb) & ~FILE_A_BB) << 7 : ((bb) & ~FILE_A_BB) >> 9)
+#define pawn_right_bb(bb, side) \
+    ((side) == WHITE ? ((bb) & ~FILE_H_BB) << 9 : ((bb) & ~FILE_H_BB) >> 7)
+#define pawn_push_delta(side)   ((side) == WHITE ? 8 : -8)
+#define pawn_left_delta(side)   ((side) == WHITE ? 7 : -9)
+#define pawn_right_delta(side)  ((side) == WHITE ? 9 : -7)
+#define promote_rank_bb(side)   ((side) == WHITE ? RANK_8_BB : RANK_1_BB)
+#define double_push_bb(side)    ((side) == WHITE ? RANK_3_BB : RANK_6_BB)
+
+/*
+ * Push a new move onto a stack of moves, first doing some sanity checks.
+ */
+static move_t* add_move(const position_t* pos,
+        move_t move,
+        move_t* moves)
+{
+    (void)pos; // avoid warning when NDEBUG is defined
+    check_move_validity(pos, move);
+    *(moves++) = move;
+    return moves;
+}
+
+/*
+ * Add a move by |piece| from |from| to each square in |targets|.
+ */
+static move_t* add_piece_moves(const position_t* pos,
+        square_t from,
+        piece_t piece,
+        bitboard_t targets,
+        move_t* moves)
+{
+    for (; targets; targets &= targets - 1) {
+        square_t to = index_to_square(first_bit(targets));
+        moves = add_move(pos,
+                create_move(from, to, piece, pos->board[to]),
+                moves);
+    }
+    return moves;
+}
+
+/*
+ * Add a pawn move to each square in |targets|, from the square |delta|
+ * indices behind it. Moves onto the last rank are added once for each
+ * possible promotion.
+ */
+static move_t* add_pawn_moves(const position_t* pos,
+        bitboard_t targets,
+        int delta,
+        move_t* moves)
+{
+    color_t side = pos->side_to_move;
+    piece_t pawn = create_piece(side, PAWN);
+    for (; targets; targets &= targets - 1) {
+        int to_ind = first_bit(targets);
+        square_t from = index_to_square(to_ind - delta);
+        square_t to = index_to_square(to_ind);
+        piece_t capture = pos->board[to];
+        if (!(set_mask[to_ind] & promote_rank_bb(side))) {
+            moves = add_move(pos, create_move(from, to, pawn, capture), moves);
+            continue;
+        }
+        for (piece_type_t promoted=QUEEN; promoted > PAWN; --promoted) {
+            moves = add_move(pos,
+                    create_move_promote(from, to, pawn, capture, promoted),
+                    moves);
+        }
+    }
+    return moves;
+}
+
+/*
+ * Add en passant captures onto |pos->ep_square| by pawns in |pawns|.
+ */
+static move_t* add_enpassant_moves(const position_t* pos,
+        bitboard_t pawns,
+        move_t* moves)
+{
+    color_t side = pos->side_to_move;
+    square_t to = pos->ep_square;
+    if (to == EMPTY || pos->board[to] != EMPTY) return moves;
+    piece_t pawn = create_piece(side, PAWN);
+    piece_t capture = pos->board[to - pawn_push[side]];
+    pawns &= pawn_attacks[side^1][square_to_index(to)];
+    for (; pawns; pawns &= pawns - 1) {
+        square_t from = index_to_square(first_bit(pawns));
+        moves = add_move(pos,
+                create_move_enpassant(from, to, pawn, capture),
+                moves);
+    }
+    return moves;
+}
+
+/*
+ * Generate pseudo-legal captures and promotions. Generates the same moves as
+ * |generate_pseudo_tactical_moves|.
+ */
+int generate_bitboard_tactical_moves(const position_t* pos, move_t* moves)
+{
+    move_t* moves_head = moves;
+    color_t side = pos->side_to_move;
+    bitboard_t occupied = occupied_squares(pos);
+    bitboard_t targets = pos->color_bb[side^1];
+    bitboard_t pawns = pos->piece_bb[create_piece(side, PAWN)];
+
+    moves = add_pawn_moves(pos,
+            pawn_push_bb(pawns, side) & ~occupied & promote_rank_bb(side),
+            pawn_push_delta(side), moves);
+    moves = add_pawn_moves(pos, pawn_left_bb(pawns, side) & targets,
+            pawn_left_delta(side), moves);
+    moves = add_pawn_moves(pos, pawn_right_bb(pawns, side) & targets,
+            pawn_right_delta(side), moves);
+    moves = add_enpassant_moves(pos, pawns, moves);
+    for (int i=0; i<pos->num_pieces[side]; ++i) {
+        square_t from = pos->pieces[side][i];
+        piece_t piece = pos->board[from];
+        moves = add_piece_moves(pos, from, piece,
+                attacks_from(piece, square_to_index(from), occupied) & targets,
+                moves);
+    }
+    *moves = 0;
+    return moves-moves_head;
+}
+
+/*
+ * Generate pseudo-legal moves which are neither captures nor promotions.
+ * Generates the same moves as |generate_pseudo_quiet_moves|.
+ */
+int generate_bitboard_quiet_moves(const position_t* pos, move_t* moves)
+{
+    move_t* moves_head = moves;
+    color_t side = pos->side_to_move;
+    bitboard_t empty = ~occupied_squares(pos);
+    bitboard_t pawns = pos->piece_bb[create_piece(side, PAWN)];
+
+    moves += generate_castles(pos, moves);
+    for (int i=0; i<pos->num_pieces[side]; ++i) {
+        square_t from = pos->pieces[side][i];
+        piece_t piece = pos->board[from];
+        moves = add_piece_moves(pos, from, piece,
+                attacks_from(piece, square_to_index(from), ~empty) & empty,
+                moves);
+    }
+    bitboard_t single = pawn_push_bb(pawns, side) & empty;
+    bitboard_t twice = pawn_push_bb(single & double_push_bb(side), side) & empty;
+    moves = add_pawn_moves(pos, single & ~promote_rank_bb(side),
+            pawn_push_delta(side), moves);
+    moves = add_pawn_moves(pos, twice, 2*pawn_push_delta(side), moves);
+    *moves = 0;
+    return moves-moves_head;
+}
+
+/*
+ * Generate all legal moves. Only king moves, en passant captures, and moves
+ * by pinned pieces can leave the king in check, so the legality of the other
+ * moves isn't tested at all.
+ */
+int generate_bitboard_legal_moves(position_t* pos, move_t* moves)
+{
+    if (is_check(pos)) return generate_bitboard_evasions(pos, moves);
+    check_info_t ci;
+    init_check_info(pos, &ci);
+    move_t* moves_tail = moves + generate_bitboard_tactical_moves(pos, moves);
+    moves_tail += generate_bitboard_quiet_moves(pos, moves_tail);
+    bitboard_t suspects = ci.pinned | set_mask[ci.king_ind];
+    move_t* moves_curr = moves;
+    while (moves_curr < moves_tail) {
+        move_t move = *moves_curr;
+        if ((sq_bit_is_set(suspects, get_move_from(move)) ||
+                    is_move_enpassant(move)) &&
+                !is_pseudo_move_legal_ci(pos, &ci, move)) {
+            *moves_curr = *(--moves_tail);
+        } else {
+            ++moves_curr;
+        }
+    }
+    *moves_tail = NO_MOVE;
+    return moves_tail-moves;
+}
+
+/*
+ * Generate all moves that evade check in the given position. Like
+ * |generate_evasions|, this is purely legal move generation.
+ */
+int generate_bitboard_evasions(const position_t* pos, move_t* moves)
+{
+    assert(pos->is_check && pos->board[pos->check_square]);
+    move_t* moves_head = moves;
+    color_t side = pos->side_to_move;
+    color_t other_side = flip_color(side);
+    square_t king_sq = pos->pieces[side][0];
+    int king_ind = square_to_index(king_sq);
+    square_t check_sq = pos->check_square;
+    int check_ind = square_to_index(check_sq);
+    bitboard_t occupied = occupied_squares(pos);
+
+    // King moves. Take the king out of the occupied squares, so that it
+    // can't shield its destination from a slider that's checking it.
+    piece_t king = create_piece(side, KING);
+    bitboard_t without_king = occupied ^ set_mask[king_ind];
+    bitboard_t targets = king_attacks[king_ind] & ~pos->color_bb[side];
+    for (; targets; targets &= targets - 1) {
+        int to_ind = first_bit(targets);
+        if (attackers_to(pos, to_ind, without_king) &
+                pos->color_bb[other_side]) continue;
+        square_t to = index_to_square(to_ind);
+        moves = add_move(pos,
+                create_move(king_sq, to, king, pos->board[to]),
+                moves);
+    }
+    // If there are multiple checkers, only king moves are possible.
+    if (pos->is_check > 1) {
+        *moves = 0;
+        return moves-moves_head;
+    }
+
+    // Everything else has to capture the checker or block the check, and
+    // pinned pieces can't do either.
+    bitboard_t pinned = king_blockers(pos, side, side);
+    bitboard_t pawns = pos->piece_bb[create_piece(side, PAWN)] & ~pinned;
+    bitboard_t checker = set_mask[check_ind];
+    bitboard_t block = between_mask[king_ind][check_ind];
+    if (check_sq + pawn_push[side] == pos->ep_square) {
+        moves = add_enpassant_moves(pos, pawns, moves);
+    }
+    moves = add_pawn_moves(pos, pawn_left_bb(pawns, side) & checker,
+            pawn_left_delta(side), moves);
+    moves = add_pawn_moves(pos, pawn_right_bb(pawns, side) & checker,
+            pawn_right_delta(side), moves);
+    if (block) {
+        bitboard_t single = pawn_push_bb(pawns, side) & ~occupied;
+        moves = add_pawn_moves(pos, single & block,
+                pawn_push_delta(side), moves);
+        moves = add_pawn_moves(pos,
+                pawn_push_bb(single & double_push_bb(side), side) & block,
+                2*pawn_push_delta(side), moves);
+    }
+    for (int i=1; i<pos->num_pieces[side]; ++i) {
+        square_t from = pos->pieces[side][i];
+        int ind = square_to_index(from);
+        if (pinned & set_mask[ind]) continue;
+        piece_t piece = pos->board[from];
+        moves = add_piece_moves(pos, from, piece,
+                attacks_from(piece, ind, occupied) & (checker | block),
+                moves);
+    }
+    *moves = 0;
+    return moves-moves_head;
+}
+
+/*
+ * Does moving from |from_ind| to |to_ind| leave the line between |from_ind|
+ * and |king_ind|?
+ */
+static bool leaves_line(int king_ind, int from_ind, int to_ind)
+{
+    return !bit_is_set(between_mask[king_ind][to_ind], from_ind) &&
+        !bit_is_set(between_mask[king_ind][from_ind], to_ind);
+}
+
+/*
+ * Generate all non-capturing, non-promoting, pseudo-legal checks. Generates
+ * the same moves as |generate_pseudo_checks|.
+ */
+int generate_bitboard_checks(const position_t* pos, move_t* moves)
+{
+    move_t* moves_head = moves;
+    color_t side = pos->side_to_move;
+    check_info_t ci;
+    init_check_info(pos, &ci);
+    int king_ind = ci.their_king_ind;
+    bitboard_t occupied = occupied_squares(pos);
+    bitboard_t empty = ~occupied;
+    bitboard_t discoverers = ci.discoverers;
+
+    // Pawns discover check by pushing unless they're on the king's file.
+    bitboard_t pawns = pos->piece_bb[create_piece(side, PAWN)];
+    bitboard_t discover = pawns & discoverers & ~file_mask[king_ind % 8];
+    bitboard_t checks = ci.check_squares[PAWN];
+    bitboard_t single = pawn_push_bb(pawns, side) & empty &
+        ~promote_rank_bb(side);
+    bitboard_t twice = pawn_push_bb(single & double_push_bb(side), side) &
+        empty;
+    discover = pawn_push_bb(discover, side);
+    moves = add_pawn_moves(pos, single & (checks | discover),
+            pawn_push_delta(side), moves);
+    discover = pawn_push_bb(discover, side);
+    moves = add_pawn_moves(pos, twice & (checks | discover),
+            2*pawn_push_delta(side), moves);
+
+    for (int i=0; i<pos->num_pieces[side]; ++i) {
+        square_t from = pos->pieces[side][i];
+        int ind = square_to_index(from);
+        piece_t piece = pos->board[from];
+        checks = ci.check_squares[piece_type(piece)];
+        bitboard_t targets = attacks_from(piece, ind, occupied) & empty;
+        if (!(discoverers & set_mask[ind])) {
+            moves = add_piece_moves(pos, from, piece, targets & checks, moves);
+            continue;
+        }
+        for (; targets; targets &= targets - 1) {
+            int to_ind = first_bit(targets);
+            if (!(checks & set_mask[to_ind]) &&
+                    !leaves_line(king_ind, ind, to_ind)) continue;
+            moves = add_move(pos,
+                    create_move(from, index_to_square(to_ind), piece, EMPTY),
+                    moves);
+        }
+    }
+    *moves = 0;
+    return moves-moves_head;
+}
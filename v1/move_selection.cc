@@ -2,41 +2,39 @@
 #include "daydreamer.h"
 #include <string.h>
 
-extern search_data_t root_data;
-static const bool defer_enabled = false;
 static bool pv_cache_enabled = true;
 
 selection_phase_t phase_table[6][8] = {
     { PHASE_BEGIN, PHASE_ROOT, PHASE_END },
     { PHASE_BEGIN, PHASE_TRANS, PHASE_PV, PHASE_DEFERRED, PHASE_END },
-    { PHASE_BEGIN, PHASE_TRANS, PHASE_NON_PV, PHASE_DEFERRED, PHASE_END },
+    { PHASE_BEGIN, PHASE_TRANS, PHASE_GOOD_TACTICS, PHASE_KILLERS,
+        PHASE_QUIET, PHASE_BAD_TACTICS, PHASE_DEFERRED, PHASE_END },
     { PHASE_BEGIN, PHASE_EVASIONS, PHASE_DEFERRED, PHASE_END },
     { PHASE_BEGIN, PHASE_TRANS, PHASE_QSEARCH, PHASE_DEFERRED, PHASE_END },
     { PHASE_BEGIN, PHASE_TRANS, PHASE_QSEARCH_CH, PHASE_DEFERRED, PHASE_END },
 };
 
-typedef struct {
-    hashkey_t key;
-    move_t moves[256];
-    int64_t nodes[256];
-} move_cache_t;
-
 static void generate_moves(move_selector_t* sel);
 static void score_moves(move_selector_t* sel);
 static void score_qsearch_moves(move_selector_t* sel);
+static void score_tactical_moves(move_selector_t* sel);
+static void score_quiet_moves(move_selector_t* sel);
+static void add_killers(move_selector_t* sel);
+static bool is_killer(move_selector_t* sel, move_t move);
 static void sort_moves(move_selector_t* sel);
 static void sort_qsearch_moves(move_selector_t* sel);
 static void sort_root_moves(move_selector_t* sel);
 static void sort_move_list(move_selector_t* sel);
 static int64_t score_tactical_move(position_t* pos, move_t move);
 static move_t get_best_move(move_selector_t* sel, int64_t* score);
-static move_cache_t* get_pv_move_list(const position_t* pos);
+static move_cache_t* get_pv_move_list(pv_cache_t* pc, const position_t* pos);
 
 /*
  * Initialize the move selector data structure with the information needed to
  * determine what kind of moves to generate and how to order them.
  */
 void init_move_selector(move_selector_t* sel,
+        search_data_t* data,
         position_t* pos,
         generation_t gen_type,
         search_node_t* search_node,
@@ -45,6 +43,8 @@ void init_move_selector(move_selector_t* sel,
         int ply)
 {
     sel->pos = pos;
+    sel->data = data;
+    sel->lock = NULL;
     if (is_check(pos) && gen_type != ROOT_GEN) {
         sel->generator = ESCAPE_GEN;
     } else {
@@ -69,10 +69,12 @@ void init_move_selector(move_selector_t* sel,
         }
         sel->killers[4] = NO_MOVE;
     } else {
-        sel->killers[0] = sel->killers[1] = NO_MOVE;
+        sel->mate_killer = NO_MOVE;
+        for (int i=0; i<5; ++i) sel->killers[i] = NO_MOVE;
     }
     sel->deferred_moves[0] = NO_MOVE;
     sel->num_deferred_moves = 0;
+    init_check_info(pos, &sel->check_info);
     generate_moves(sel);
 }
 
@@ -117,10 +119,16 @@ float lmr_reduction(move_selector_t* sel, move_t move, bool full_window)
 
 /*
  * Fill the list of candidate moves and score each move for later selection.
+ * Non-pv nodes generate their moves in stages, so a node that cuts off early
+ * doesn't generate or score moves it never searches. Tactical moves go at
+ * the start of |base_moves|, split into good and bad ones by SEE, and the
+ * killers and quiet moves go after them.
  */
 static void generate_moves(move_selector_t* sel)
 {
     sel->phase++;
+    assert(*sel->phase < MAX_SELECTION_PHASES);
+    sel->data->stats.phase_starts[*sel->phase]++;
     sel->moves_end = 0;
     sel->current_move_index = 0;
     sel->moves = sel->base_moves;
@@ -143,8 +151,13 @@ static void generate_moves(move_selector_t* sel)
             sort_root_moves(sel);
             break;
         case PHASE_PV:
-            pv_cache = get_pv_move_list(sel->pos);
-            if (pv_cache_enabled && pv_cache->key == sel->pos->hash) {
+            // The pv cache is only maintained by the main search thread,
+            // and can't be read safely once the selector is shared.
+            pv_cache = sel->data->thread_id == 0 && !sel->lock &&
+                sel->data->pv_cache ?
+                get_pv_move_list(sel->data->pv_cache, sel->pos) : NULL;
+            if (pv_cache_enabled && pv_cache &&
+                    pv_cache->key == sel->pos->hash) {
                 int i;
                 for (i=0; pv_cache->moves[i]; ++i) {
                     sel->moves[i] = pv_cache->moves[i];
@@ -160,6 +173,33 @@ static void generate_moves(move_selector_t* sel)
             sel->moves_end = generate_pseudo_moves(sel->pos, sel->moves);
             sort_moves(sel);
             break;
+        case PHASE_GOOD_TACTICS:
+            sel->num_tactics = generate_pseudo_tactical_moves(sel->pos,
+                    sel->moves);
+            score_tactical_moves(sel);
+            sort_move_list(sel);
+            sel->bad_tactics = 0;
+            while (sel->bad_tactics < sel->num_tactics &&
+                    sel->scores[sel->bad_tactics] >= 0) sel->bad_tactics++;
+            sel->moves_end = sel->bad_tactics;
+            break;
+        case PHASE_KILLERS:
+            sel->moves += sel->num_tactics + 1;
+            sel->scores += sel->num_tactics + 1;
+            add_killers(sel);
+            break;
+        case PHASE_QUIET:
+            sel->moves += sel->num_tactics + 1;
+            sel->scores += sel->num_tactics + 1;
+            sel->moves_end = generate_pseudo_quiet_moves(sel->pos, sel->moves);
+            score_quiet_moves(sel);
+            sort_move_list(sel);
+            break;
+        case PHASE_BAD_TACTICS:
+            sel->moves += sel->bad_tactics;
+            sel->scores += sel->bad_tactics;
+            sel->moves_end = sel->num_tactics - sel->bad_tactics;
+            break;
         case PHASE_QSEARCH_CH:
             sel->moves_end = generate_quiescence_moves(
                     sel->pos, sel->moves, true);
@@ -172,12 +212,14 @@ static void generate_moves(move_selector_t* sel)
             break;
         case PHASE_DEFERRED:
             sel->moves = sel->deferred_moves;
+            sel->scores = sel->deferred_scores;
             sel->moves_end = sel->num_deferred_moves;
             break;
         default: assert(false);
     }
     sel->single_reply = sel->generator == ESCAPE_GEN && sel->moves_end == 1;
-    assert(sel->moves[sel->moves_end] == NO_MOVE);
+    assert(*sel->phase == PHASE_GOOD_TACTICS ||
+            sel->moves[sel->moves_end] == NO_MOVE);
     assert(sel->current_move_index == 0);
 }
 
@@ -211,7 +253,8 @@ move_t select_move(move_selector_t* sel)
                 move = sel->moves[sel->current_move_index++];
                 if (!move) break;
                 if (move == sel->hash_move[0] ||
-                        !is_pseudo_move_legal(sel->pos, move)) continue;
+                        !is_pseudo_move_legal_ci(sel->pos,
+                            &sel->check_info, move)) continue;
                 check_pseudo_move_legality(sel->pos, move);
                 sel->moves_so_far++;
                 if (!get_move_capture(move) && get_move_promote(move)!=QUEEN) {
@@ -221,6 +264,50 @@ move_t select_move(move_selector_t* sel)
             }
             break;
 
+        case PHASE_GOOD_TACTICS:
+            // Good tactics are followed by the bad ones, rather than
+            // terminated, so stop at the boundary between them.
+            while (sel->current_move_index < sel->moves_end) {
+                move = sel->moves[sel->current_move_index++];
+                if (move == sel->hash_move[0] ||
+                        !is_pseudo_move_legal_ci(sel->pos,
+                            &sel->check_info, move)) continue;
+                check_pseudo_move_legality(sel->pos, move);
+                sel->moves_so_far++;
+                return move;
+            }
+            break;
+        case PHASE_KILLERS:
+            while ((move = sel->moves[sel->current_move_index++])) {
+                if (!is_plausible_move_legal(sel->pos, move)) continue;
+                sel->moves_so_far++;
+                sel->quiet_moves_so_far++;
+                return move;
+            }
+            break;
+        case PHASE_QUIET:
+            while ((move = sel->moves[sel->current_move_index++])) {
+                if (move == sel->hash_move[0] || is_killer(sel, move) ||
+                        !is_pseudo_move_legal_ci(sel->pos,
+                            &sel->check_info, move)) continue;
+                check_pseudo_move_legality(sel->pos, move);
+                sel->moves_so_far++;
+                sel->quiet_moves_so_far++;
+                return move;
+            }
+            break;
+        case PHASE_BAD_TACTICS:
+            while ((move = sel->moves[sel->current_move_index++])) {
+                if (move == sel->hash_move[0] ||
+                        !is_pseudo_move_legal_ci(sel->pos,
+                            &sel->check_info, move)) continue;
+                check_pseudo_move_legality(sel->pos, move);
+                sel->moves_so_far++;
+                if (get_move_promote(move) != QUEEN &&
+                        !get_move_capture(move)) sel->quiet_moves_so_far++;
+                return move;
+            }
+            break;
         case PHASE_QSEARCH:
         case PHASE_QSEARCH_CH:
             while (true) {
@@ -230,7 +317,8 @@ move_t select_move(move_selector_t* sel)
                 const piece_type_t promote = get_move_promote(move);
                 if (promote && promote != QUEEN) continue;
                 if (move == sel->hash_move[0] ||
-                        !is_pseudo_move_legal(sel->pos, move)) continue;
+                        !is_pseudo_move_legal_ci(sel->pos,
+                            &sel->check_info, move)) continue;
                 check_pseudo_move_legality(sel->pos, move);
                 sel->moves_so_far++;
                 if (!get_move_capture(move) && promote != QUEEN) {
@@ -257,6 +345,26 @@ move_t select_move(move_selector_t* sel)
     return select_move(sel);
 }
 
+/*
+ * Return the next move from a selector that's shared between the threads
+ * searching a split point. Other threads may advance the selector as soon
+ * as its lock is released, so the move's ordinal and its lmr reduction are
+ * returned along with it.
+ */
+move_t select_shared_move(move_selector_t* sel,
+        bool full_window,
+        int* move_number,
+        float* lmr_red)
+{
+    assert(sel->lock);
+    lock_mutex(sel->lock);
+    move_t move = select_move(sel);
+    *move_number = sel->moves_so_far;
+    *lmr_red = move ? lmr_reduction(sel, move, full_window) : 0;
+    unlock_mutex(sel->lock);
+    return move;
+}
+
 /*
  * Take an unordered list of pseudo-legal moves and score them according
  * to how good we think they'll be. This just identifies a few key classes
@@ -289,7 +397,7 @@ static void score_moves(move_selector_t* sel)
         } else if (move == sel->killers[3]) {
             score = killer_score-3;
         } else {
-            score = (int64_t)root_data.history.history[history_index(move)];
+            score = (int64_t)sel->data->history.history[history_index(move)];
         }
         scores[i] = score;
     }
@@ -320,12 +428,70 @@ static void score_qsearch_moves(move_selector_t* sel)
             if (promote == QUEEN) tactic_bonus = 100;
             score = 6*capture - piece + 5 + tactic_bonus;
         } else {
-            score = root_data.history.history[history_index(move)];
+            score = sel->data->history.history[history_index(move)];
         }
         scores[i] = score;
     }
 }
 
+/*
+ * Score the tactical moves at a non-pv node. Moves that SEE says lose
+ * material get negative scores, and are searched after the quiet moves.
+ */
+static void score_tactical_moves(move_selector_t* sel)
+{
+    for (int i=0; sel->moves[i] != NO_MOVE; ++i) {
+        sel->scores[i] = score_tactical_move(sel->pos, sel->moves[i]);
+    }
+}
+
+/*
+ * Score the quiet moves at a non-pv node by their history.
+ */
+static void score_quiet_moves(move_selector_t* sel)
+{
+    for (int i=0; sel->moves[i] != NO_MOVE; ++i) {
+        sel->scores[i] = (int64_t)sel->data->history.history[
+            history_index(sel->moves[i])];
+    }
+}
+
+/*
+ * Fill the move list with the mate killer and the killers that might be
+ * quiet moves in this position, in order. Their legality isn't checked
+ * until they're selected.
+ */
+static void add_killers(move_selector_t* sel)
+{
+    const int64_t grain = MAX_HISTORY;
+    const int64_t killer_score = 700 * grain;
+    move_t candidates[5] = { sel->mate_killer, sel->killers[0],
+        sel->killers[1], sel->killers[2], sel->killers[3] };
+    int n = 0;
+    for (int i=0; i<5; ++i) {
+        move_t move = candidates[i];
+        if (!move || move == sel->hash_move[0] ||
+                get_move_capture(move) || get_move_promote(move)) continue;
+        bool duplicate = false;
+        for (int j=0; j<n; ++j) duplicate |= sel->moves[j] == move;
+        if (duplicate) continue;
+        sel->scores[n] = killer_score - i;
+        sel->moves[n++] = move;
+    }
+    sel->moves[n] = NO_MOVE;
+    sel->moves_end = n;
+}
+
+/*
+ * Was |move| already tried in the killer phase?
+ */
+static bool is_killer(move_selector_t* sel, move_t move)
+{
+    return move == sel->mate_killer ||
+        move == sel->killers[0] || move == sel->killers[1] ||
+        move == sel->killers[2] || move == sel->killers[3];
+}
+
 /*
  * Determine a score for a capturing or promoting move.
  */
@@ -353,16 +519,16 @@ static int64_t score_tactical_move(position_t* pos, move_t move)
 static void sort_root_moves(move_selector_t* sel)
 {
     int i;
-    for (i=0; root_data.root_moves[i].move != NO_MOVE; ++i) {
-        sel->moves[i] = root_data.root_moves[i].move;
+    for (i=0; sel->data->root_moves[i].move != NO_MOVE; ++i) {
+        sel->moves[i] = sel->data->root_moves[i].move;
         if (sel->moves[i] == sel->hash_move[0]) {
             sel->scores[i] = INT64_MAX;
         } else if (sel->depth <= 2*PLY) {
-            sel->scores[i] = root_data.root_moves[i].qsearch_score;
+            sel->scores[i] = sel->data->root_moves[i].qsearch_score;
         } else if (options.multi_pv > 1) {
-            sel->scores[i] = root_data.root_moves[i].score;
+            sel->scores[i] = sel->data->root_moves[i].score;
         } else {
-            sel->scores[i] = (int64_t)root_data.root_moves[i].nodes;
+            sel->scores[i] = (int64_t)sel->data->root_moves[i].nodes;
         }
     }
     sel->moves_end = i;
@@ -408,32 +574,28 @@ static void sort_move_list(move_selector_t* sel)
 }
 
 /*
- * Add the move to a list of deferred moves, which will be retried in the
- * last phase. Currently this isn't used; I haven't found a deferment scheme
- * that helps at all.
+ * Add the most recently selected move to a list of deferred moves, which
+ * will be retried in the last phase. ABDADA parallel search uses this to
+ * put off moves that another thread is already searching.
  */
 bool defer_move(move_selector_t* sel, move_t move)
 {
-    if (!defer_enabled) return false;
-    assert(move == sel->moves[sel->current_move_index]);
     if (*sel->phase == PHASE_DEFERRED ||
-            *sel->phase == PHASE_TRANS ||
-            sel->scores[sel->current_move_index] > MAX_HISTORY) return false;
+            *sel->phase == PHASE_TRANS) return false;
+    assert(move == sel->moves[sel->current_move_index-1]);
+    sel->deferred_scores[sel->num_deferred_moves] =
+        sel->scores[sel->current_move_index-1];
     sel->deferred_moves[sel->num_deferred_moves++] = move;
     sel->deferred_moves[sel->num_deferred_moves] = NO_MOVE;
     sel->moves_so_far--;
+    if (!get_move_capture(move) && get_move_promote(move)!=QUEEN) {
+        sel->quiet_moves_so_far--;
+    }
     return true;
 }
 
-struct {
-    int hits;
-    int misses;
-    int occupied;
-    int evictions;
-} pv_cache_stats;
-
-static move_cache_t* pv_cache = NULL;
-static int num_buckets;
+// The cache used by the engine's own search.
+pv_cache_t default_pv_cache;
 
 /*
  * The pv cache stores counts of nodes searched under each move for a given
@@ -441,40 +603,48 @@ static int num_buckets;
  * selection, moves are ordered by nodes searched rather than other heuristics.
  * This function allocates memory and initializes the pv cache.
  */
-void init_pv_cache(const int max_bytes)
+void init_pv_cache(pv_cache_t* pc, const int max_bytes)
 {
     assert(max_bytes >= 1024);
-    int size = sizeof(move_cache_t);
-    num_buckets = 1;
-    while (size <= max_bytes >> 1) {
-        size <<= 1;
-        num_buckets <<= 1;
-    }
-    if (pv_cache != NULL) free(pv_cache);
-    pv_cache = (move_cache_t*)malloc(size);
-    assert(pv_cache);
-    clear_pv_cache();
+    pc->num_buckets = MAX(max_bytes / (int)sizeof(move_cache_t), 1);
+    int size = pc->num_buckets * sizeof(move_cache_t);
+    alloc_table_memory(&pc->memory, size,
+            options.large_pages ? TABLE_LARGE_PAGES : 0);
+    pc->entries = (move_cache_t*)pc->memory.ptr;
+    assert(pc->entries);
+    memset(&pc->stats, 0, sizeof(pc->stats));
+}
+
+/*
+ * Release the memory held by |pc|.
+ */
+void destroy_pv_cache(pv_cache_t* pc)
+{
+    free_table_memory(&pc->memory);
+    pc->entries = NULL;
+    pc->num_buckets = 0;
 }
 
 /*
  * Clear all entries in the pv cache.
  */
-void clear_pv_cache(void)
+void clear_pv_cache(pv_cache_t* pc)
 {
-    memset(pv_cache, 0, num_buckets*sizeof(move_cache_t));
+    clear_table_memory(&pc->memory);
+    memset(&pc->stats, 0, sizeof(pc->stats));
 }
 
 /*
  * Retrieve the pv cache entry associated with |pos|.
  */
-static move_cache_t* get_pv_move_list(const position_t* pos)
+static move_cache_t* get_pv_move_list(pv_cache_t* pc, const position_t* pos)
 {
-    move_cache_t* m = &pv_cache[pos->hash % num_buckets];
-    if (m->key == pos->hash) pv_cache_stats.hits++;
-    else if (m->key != 0) pv_cache_stats.evictions++;
+    move_cache_t* m = &pc->entries[hash_index(pos->hash, pc->num_buckets)];
+    if (m->key == pos->hash) pc->stats.hits++;
+    else if (m->key != 0) pc->stats.evictions++;
     else {
-        pv_cache_stats.misses++;
-        pv_cache_stats.occupied++;
+        pc->stats.misses++;
+        pc->stats.occupied++;
     }
     return m;
 }
@@ -484,7 +654,7 @@ static move_cache_t* get_pv_move_list(const position_t* pos)
  */
 void add_pv_move(move_selector_t* sel, move_t move, int64_t nodes)
 {
-    if (sel->generator == ESCAPE_GEN) return;
+    if (sel->generator == ESCAPE_GEN || sel->data->thread_id) return;
     assert2(is_pseudo_move_legal(sel->pos, move));
     assert2(is_move_legal(sel->pos, move));
     sel->pv_moves[sel->pv_index] = move;
@@ -497,9 +667,10 @@ void add_pv_move(move_selector_t* sel, move_t move, int64_t nodes)
  */
 void commit_pv_moves(move_selector_t* sel)
 {
-    if (sel->generator == ESCAPE_GEN) return;
+    if (sel->generator == ESCAPE_GEN || sel->data->thread_id ||
+            !sel->data->pv_cache) return;
     assert(sel->pv_index == sel->moves_so_far);
-    move_cache_t* pv_cache = get_pv_move_list(sel->pos);
+    move_cache_t* pv_cache = get_pv_move_list(sel->data->pv_cache, sel->pos);
     pv_cache->key = sel->pos->hash;
     int i;
     for (i=0; i < sel->pv_index; ++i) {
@@ -514,17 +685,17 @@ void commit_pv_moves(move_selector_t* sel)
 /*
  * Dump some information about pv cache activity to stdout.
  */
-void print_pv_cache_stats(void)
+void print_pv_cache_stats(pv_cache_t* pc)
 {
-    printf("info string pv cache entries %d", num_buckets);
-    printf(" filled %d (%.2f%%)", pv_cache_stats.occupied,
-            (float)pv_cache_stats.occupied / (float)num_buckets*100.);
-    printf(" evictions %d", pv_cache_stats.evictions);
-    printf(" hits %d (%.2f%%)", pv_cache_stats.hits,
-            (float)pv_cache_stats.hits /
-            (pv_cache_stats.hits + pv_cache_stats.misses)*100.);
-    printf(" misses %d (%.2f%%)\n", pv_cache_stats.misses,
-            (float)pv_cache_stats.misses /
-            (pv_cache_stats.hits + pv_cache_stats.misses)*100.);
+    printf("info string pv cache entries %d", pc->num_buckets);
+    printf(" filled %d (%.2f%%)", pc->stats.occupied,
+            (float)pc->stats.occupied / (float)pc->num_buckets*100.);
+    printf(" evictions %d", pc->stats.evictions);
+    printf(" hits %d (%.2f%%)", pc->stats.hits,
+            (float)pc->stats.hits /
+            (pc->stats.hits + pc->stats.misses)*100.);
+    printf(" misses %d (%.2f%%)\n", pc->stats.misses,
+            (float)pc->stats.misses /
+            (pc->stats.hits + pc->stats.misses)*100.);
 }
 
@@ -28,11 +28,32 @@ typedef enum {
 } selection_phase_t;
 
 typedef struct {
+    hashkey_t key;
+    move_t moves[256];
+    int64_t nodes[256];
+} move_cache_t;
+
+typedef struct pv_cache_t {
+    move_cache_t* entries;
+    table_memory_t memory;
+    int num_buckets;
+    struct {
+        int hits;
+        int misses;
+        int occupied;
+        int evictions;
+    } stats;
+} pv_cache_t;
+
+extern pv_cache_t default_pv_cache;
+
+typedef struct move_selector_t {
     selection_phase_t* phase;
     move_t* moves;
     int64_t* scores;
     move_t base_moves[256];
     move_t deferred_moves[256];
+    int64_t deferred_scores[256];
     int num_deferred_moves;
     int64_t base_scores[256];
     move_t pv_moves[256];
@@ -40,6 +61,8 @@ typedef struct {
     int pv_index;
     int moves_end;
     int current_move_index;
+    int num_tactics;
+    int bad_tactics;
     generation_t generator;
     move_t hash_move[2];
     move_t mate_killer;
@@ -48,7 +71,10 @@ typedef struct {
     int moves_so_far;
     int quiet_moves_so_far;
     float depth;
+    check_info_t check_info;
     position_t* pos;
+    search_data_t* data;
+    mutex_t* lock;
     bool single_reply;
 } move_selector_t;
 
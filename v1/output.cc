@@ -52,7 +52,7 @@ static void print_pv(search_data_t* data, int ordinal, int index)
     const int score = data->root_moves[index].score;
     // note: use time+1 to avoid divide-by-zero
     const int time = elapsed_time(&data->timer) + 1;
-    const uint64_t nodes = data->nodes_searched;
+    const uint64_t nodes = total_nodes_searched(data);
 
     if (options.verbosity) {
         char sanpv[1024];
@@ -67,14 +67,16 @@ static void print_pv(search_data_t* data, int ordinal, int index)
         if (options.verbosity > 1) printf(" qnodes %"PRIu64" pvnodes %"PRIu64,
                 data->qnodes_searched, data->pvnodes_searched);
         printf(" nps %"PRIu64" hashfull %d tbhits %d pv ",
-                nodes/(time+1)*1000, get_hashfull(), data->stats.egbb_hits);
+                nodes/(time+1)*1000, get_hashfull(data->trans_table),
+                data->stats.egbb_hits);
     } else {
         printf("info multipv %d depth %d seldepth %d score cp %d time %d "
                 "nodes %"PRIu64, ordinal, depth, seldepth, score, time, nodes);
         if (options.verbosity > 1) printf(" qnodes %"PRIu64" pvnodes %"PRIu64,
                 data->qnodes_searched, data->pvnodes_searched);
         printf(" nps %"PRIu64" hashfull %d tbhits %d pv ",
-                nodes/(time+1)*1000, get_hashfull(), data->stats.egbb_hits);
+                nodes/(time+1)*1000, get_hashfull(data->trans_table),
+                data->stats.egbb_hits);
     }
     int moves = print_coord_move_list(pv);
     if (moves < depth) {
@@ -85,9 +87,9 @@ static void print_pv(search_data_t* data, int ordinal, int index)
         copy_position(&pos, &data->root_pos);
         for (int i=0; pv[i] != NO_MOVE; ++i) do_move(&pos, pv[i], &undo);
 
-        transposition_entry_t* entry;
+        transposition_entry_t entry_copy, *entry;
         while (moves < depth) {
-            entry = get_transposition(&pos);
+            entry = get_transposition(data->trans_table, &pos, &entry_copy);
             if (!entry || !is_move_legal(&pos, entry->move)) break;
             print_coord_move(entry->move);
             do_move(&pos, entry->move, &undo);
@@ -185,6 +187,18 @@ void print_search_stats(const search_data_t* search_data)
     if (search_data->obvious_move) {
         printf("info string this move seemed obvious\n");
     }
+    // Names of each selection_phase_t, for phase statistics.
+    const char* phase_names[] = { "begin", "end", "root", "trans",
+        "evasions", "pv", "nonpv", "qsearch", "qsearch_checks", "killers",
+        "good_tactics", "bad_tactics", "quiet", "deferred" };
+    printf("info string cutoffs/starts by phase");
+    for (int i=PHASE_ROOT; i<=PHASE_DEFERRED; ++i) {
+        if (!search_data->stats.phase_starts[i]) continue;
+        printf(" %s %d/%d", phase_names[i],
+                search_data->stats.phase_cutoffs[i],
+                search_data->stats.phase_starts[i]);
+    }
+    printf("\n");
     int high = search_data->stats.root_fail_highs;
     int low = search_data->stats.root_fail_lows;
     printf("info string root fail highs %d fail lows %d exact results %d\n",
@@ -2,10 +2,158 @@
 #include "daydreamer.h"
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-static uint64_t full_search(position_t* pos, int depth);
-static uint64_t divide(position_t* pos, int depth);
+#define MAX_PERFT_LINE      4096
+#define MAX_PERFT_DEPTHS    32
+
+typedef struct {
+    char fen[MAX_PERFT_LINE];
+    int num_depths;
+    int depth[MAX_PERFT_DEPTHS];
+    uint64_t expected[MAX_PERFT_DEPTHS];
+    uint64_t result[MAX_PERFT_DEPTHS];
+    int time[MAX_PERFT_DEPTHS];
+    bool done;
+} perft_test_t;
+
+// A subtree of a parallel perft: the moves leading to it from the root, and
+// the number of leaf nodes found under it.
+typedef struct {
+    move_t moves[2];
+    int num_moves;
+    int root_index;
+    uint64_t nodes;
+} perft_job_t;
+
+// Work shared by the threads running a parallel perft or perft suite. Jobs
+// and tests are claimed in order under the lock.
+static struct {
+    const position_t* root_pos;
+    int depth;
+    perft_job_t* jobs;
+    int num_jobs;
+    perft_test_t* tests;
+    int num_tests;
+    int next;
+    int next_report;
+    int correct_tests;
+    uint64_t total_nodes;
+    mutex_t lock;
+} perft_work;
+
+// Perft results are cached by position and remaining depth. Entries are
+// written by all perft threads without locking; the key is stored xored
+// with the data, so an entry torn by concurrent writes just fails to match.
+typedef struct {
+    hashkey_t check;
+    uint64_t data; // node count << 8 | depth
+} perft_entry_t;
+
+static struct {
+    perft_entry_t* entries;
+    size_t num_entries;
+} perft_table;
+
+#define perft_index(hash, depth) \
+    hash_index((hash) ^ ((hashkey_t)(depth) * 0x9e3779b97f4a7c15ull), \
+            perft_table.num_entries)
+
+typedef void(*perft_worker_fn)(search_data_t*);
+typedef struct {
+    perft_worker_fn worker;
+    search_data_t* data;
+} perft_thread_t;
+
+static int perft_moves(search_data_t* data, position_t* pos, move_t* moves);
+static uint64_t full_search(search_data_t* data, position_t* pos, int depth);
+static uint64_t divide(position_t* pos, int depth, bool print);
+static void perft_suite_worker(search_data_t* data);
+static THREAD_FN(perft_worker_thread, arg);
+
+/*
+ * Create a perft hash table using at most |max_bytes| of memory, or remove
+ * the table if |max_bytes| is 0.
+ */
+void init_perft_table(const size_t max_bytes)
+{
+    free(perft_table.entries);
+    perft_table.entries = NULL;
+    perft_table.num_entries = 0;
+    if (max_bytes < sizeof(perft_entry_t)) return;
+    perft_table.num_entries = max_bytes / sizeof(perft_entry_t);
+    perft_table.entries = (perft_entry_t*)calloc(perft_table.num_entries,
+            sizeof(perft_entry_t));
+    if (!perft_table.entries) perft_table.num_entries = 0;
+}
+
+/*
+ * Look up the number of nodes at depth |depth| below the position with the
+ * given hash.
+ */
+static bool probe_perft_table(hashkey_t hash, int depth, uint64_t* nodes)
+{
+    if (!perft_table.entries) return false;
+    perft_entry_t* entry = &perft_table.entries[perft_index(hash, depth)];
+    uint64_t data = entry->data;
+    if ((entry->check ^ data) != hash || (int)(data & 0xff) != depth) {
+        return false;
+    }
+    *nodes = data >> 8;
+    return true;
+}
+
+/*
+ * Record the number of nodes at depth |depth| below the position with the
+ * given hash, replacing whatever was stored there before.
+ */
+static void store_perft_table(hashkey_t hash, int depth, uint64_t nodes)
+{
+    if (!perft_table.entries) return;
+    perft_entry_t* entry = &perft_table.entries[perft_index(hash, depth)];
+    uint64_t data = nodes << 8 | depth;
+    entry->check = hash ^ data;
+    entry->data = data;
+}
+
+/*
+ * Run |worker| on options.num_threads threads, including the calling
+ * thread, and wait for them all to finish. Each thread gets private search
+ * data for its move selectors, so they don't touch the main search's pv
+ * cache.
+ */
+static void run_perft_workers(perft_worker_fn worker)
+{
+    int num_threads = CLAMP(options.num_threads, 1, MAX_SEARCH_THREADS);
+    thread_t threads[MAX_SEARCH_THREADS];
+    perft_thread_t helpers[MAX_SEARCH_THREADS];
+    int num_helpers = 0;
+    for (; num_helpers < num_threads-1; ++num_helpers) {
+        perft_thread_t* helper = &helpers[num_helpers];
+        helper->worker = worker;
+        helper->data = (search_data_t*)calloc(1, sizeof(search_data_t));
+        if (!helper->data) break;
+        if (!create_thread(&threads[num_helpers],
+                    perft_worker_thread, helper)) {
+            warn("failed to create perft thread");
+            free(helper->data);
+            break;
+        }
+    }
+    worker(&root_data);
+    for (int i=0; i<num_helpers; ++i) {
+        join_thread(threads[i]);
+        free(helpers[i].data);
+    }
+}
+
+static THREAD_FN(perft_worker_thread, arg)
+{
+    perft_thread_t* thread = (perft_thread_t*)arg;
+    thread->worker(thread->data);
+    THREAD_RETURN;
+}
 
 /*
  * Execute a series of perft tests from a given file. The test file consists of
@@ -14,16 +162,15 @@ static uint64_t divide(position_t* pos, int depth);
  * where <d> is the target depth and <nodes is the number of nodes at that
  * depth. So, for example, to test the initial position at depths 1 and 2:
  * rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 ;D1 20 ;D2 400
- * The test results and elapsed time are printed to stdout.
+ * The test results and elapsed time are printed to stdout. Test lines are
+ * spread over options.num_threads threads, and reported in file order.
  *
  * This file format and the associated test files are taken from ROCE. For
  * more information, see http://www.rocechess.ch/rocee.html.
  */
 void perft_testsuite(char* filename)
 {
-    char test_storage[4096];
-    char* test = test_storage;
-    position_t pos;
+    char test_storage[MAX_PERFT_LINE];
     milli_timer_t perft_timer;
     init_timer(&perft_timer);
     FILE* test_file = fopen(filename, "r");
@@ -32,33 +179,167 @@ void perft_testsuite(char* filename)
                 filename, strerror(errno));
         return;
     }
-    int total_tests = 0, correct_tests = 0;
-    while (fgets(test, 4096, test_file)) {
-        char* fen = strsep(&test, ";");
-        set_position(&pos, fen);
-        printf("Test %d: %s\n", total_tests+1, fen);
-        bool failure = false;
+    memset(&perft_work, 0, sizeof(perft_work));
+    int capacity = 0;
+    while (fgets(test_storage, MAX_PERFT_LINE, test_file)) {
+        if (perft_work.num_tests == capacity) {
+            capacity = capacity ? 2*capacity : 256;
+            perft_work.tests = (perft_test_t*)realloc(perft_work.tests,
+                    capacity*sizeof(perft_test_t));
+            assert(perft_work.tests);
+        }
+        perft_test_t* t = &perft_work.tests[perft_work.num_tests++];
+        char* test = test_storage;
+        strcpy(t->fen, strsep(&test, ";"));
+        t->num_depths = 0;
+        t->done = false;
         do {
-            int depth;
-            uint64_t correct_answer;
-            sscanf(test, "D%d %"PRIu64, &depth, &correct_answer);
-            start_timer(&perft_timer);
-            uint64_t result = full_search(&pos, depth);
-            int time = stop_timer(&perft_timer);
-            printf("\tDepth %d: %15"PRIu64, depth, result);
-            if (result != correct_answer) {
-                failure = true;
-                printf(" expected %15"PRIu64" -- FAIL",
-                        correct_answer);
-            } else printf(" -- SUCCESS");
-            printf(" / %.2fs\n", time/1000.0);
+            if (t->num_depths == MAX_PERFT_DEPTHS) break;
+            sscanf(test, "D%d %"PRIu64, &t->depth[t->num_depths],
+                    &t->expected[t->num_depths]);
+            ++t->num_depths;
         } while ((test = strchr(test, ';') + 1) != (char*)1);
-        ++total_tests;
-        if (!failure) ++correct_tests;
-        test = test_storage;
     }
+    fclose(test_file);
+
+    init_mutex(&perft_work.lock);
+    start_timer(&perft_timer);
+    run_perft_workers(perft_suite_worker);
+    int time = stop_timer(&perft_timer);
+    destroy_mutex(&perft_work.lock);
+    free(perft_work.tests);
     printf("Tests completed. %d/%d tests passed in %.2fs.\n",
-            correct_tests, total_tests, elapsed_time(&perft_timer)/1000.0);
+            perft_work.correct_tests, perft_work.num_tests, time/1000.0);
+    printf("%"PRIu64" nodes, %"PRIu64" nps\n", perft_work.total_nodes,
+            perft_work.total_nodes*1000/MAX(time, 1));
+}
+
+/*
+ * Print results for every finished test that hasn't been reported yet and
+ * doesn't follow an unfinished test. Called with the work lock held.
+ */
+static void report_perft_tests(void)
+{
+    while (perft_work.next_report < perft_work.num_tests &&
+            perft_work.tests[perft_work.next_report].done) {
+        perft_test_t* t = &perft_work.tests[perft_work.next_report++];
+        printf("Test %d: %s\n", perft_work.next_report, t->fen);
+        bool failure = false;
+        for (int i=0; i<t->num_depths; ++i) {
+            printf("\tDepth %d: %15"PRIu64, t->depth[i], t->result[i]);
+            perft_work.total_nodes += t->result[i];
+            if (t->result[i] != t->expected[i]) {
+                failure = true;
+                printf(" expected %15"PRIu64" -- FAIL", t->expected[i]);
+            } else printf(" -- SUCCESS");
+            printf(" / %.2fs\n", t->time[i]/1000.0);
+        }
+        if (!failure) ++perft_work.correct_tests;
+    }
+    fflush(stdout);
+}
+
+/*
+ * Run perft suite tests until there are none left.
+ */
+static void perft_suite_worker(search_data_t* data)
+{
+    position_t pos;
+    milli_timer_t timer;
+    while (true) {
+        lock_mutex(&perft_work.lock);
+        int index = perft_work.next++;
+        unlock_mutex(&perft_work.lock);
+        if (index >= perft_work.num_tests) break;
+        perft_test_t* t = &perft_work.tests[index];
+        set_position(&pos, t->fen);
+        for (int i=0; i<t->num_depths; ++i) {
+            init_timer(&timer);
+            start_timer(&timer);
+            t->result[i] = full_search(data, &pos, t->depth[i]);
+            t->time[i] = stop_timer(&timer);
+        }
+        lock_mutex(&perft_work.lock);
+        t->done = true;
+        report_perft_tests();
+        unlock_mutex(&perft_work.lock);
+    }
+}
+
+/*
+ * Count nodes under parallel perft jobs until there are none left.
+ */
+static void perft_job_worker(search_data_t* data)
+{
+    position_t pos;
+    copy_position(&pos, perft_work.root_pos);
+    while (true) {
+        lock_mutex(&perft_work.lock);
+        int index = perft_work.next++;
+        unlock_mutex(&perft_work.lock);
+        if (index >= perft_work.num_jobs) break;
+        perft_job_t* job = &perft_work.jobs[index];
+        undo_info_t undo[2];
+        for (int i=0; i<job->num_moves; ++i) {
+            do_move(&pos, job->moves[i], &undo[i]);
+        }
+        job->nodes = full_search(data, &pos,
+                perft_work.depth - job->num_moves);
+        for (int i=job->num_moves-1; i>=0; --i) {
+            undo_move(&pos, job->moves[i], &undo[i]);
+        }
+    }
+}
+
+/*
+ * Count the nodes at depth |depth| under each of the given root moves, and
+ * store the counts in |nodes|. The tree is split at the root, or at ply 2
+ * if it's deep enough, and the pieces are searched by options.num_threads
+ * threads.
+ */
+static void parallel_perft(position_t* pos,
+        int depth,
+        const move_t* root_moves,
+        int num_root_moves,
+        uint64_t* nodes)
+{
+    int max_jobs = num_root_moves * (depth > 2 ? 256 : 1);
+    memset(&perft_work, 0, sizeof(perft_work));
+    perft_work.jobs = (perft_job_t*)malloc(max_jobs * sizeof(perft_job_t));
+    assert(perft_work.jobs);
+    perft_work.root_pos = pos;
+    perft_work.depth = depth;
+    for (int i=0; i<num_root_moves; ++i) {
+        perft_job_t* job;
+        if (depth <= 2) {
+            job = &perft_work.jobs[perft_work.num_jobs++];
+            job->moves[0] = root_moves[i];
+            job->num_moves = 1;
+            job->root_index = i;
+            continue;
+        }
+        move_t moves[256];
+        undo_info_t undo;
+        do_move(pos, root_moves[i], &undo);
+        int num_moves = perft_moves(&root_data, pos, moves);
+        undo_move(pos, root_moves[i], &undo);
+        for (int j=0; j<num_moves; ++j) {
+            job = &perft_work.jobs[perft_work.num_jobs++];
+            job->moves[0] = root_moves[i];
+            job->moves[1] = moves[j];
+            job->num_moves = 2;
+            job->root_index = i;
+        }
+    }
+
+    init_mutex(&perft_work.lock);
+    run_perft_workers(perft_job_worker);
+    destroy_mutex(&perft_work.lock);
+    for (int i=0; i<num_root_moves; ++i) nodes[i] = 0;
+    for (int i=0; i<perft_work.num_jobs; ++i) {
+        nodes[perft_work.jobs[i].root_index] += perft_work.jobs[i].nodes;
+    }
+    free(perft_work.jobs);
 }
 
 /*
@@ -68,82 +349,100 @@ void perft_testsuite(char* filename)
  */
 uint64_t perft(position_t* position, int depth, bool div)
 {
+    // Work on a copy, so that the order of the piece lists (and therefore
+    // of moves in divide output) doesn't depend on earlier perft calls.
+    position_t pos;
+    copy_position(&pos, position);
     milli_timer_t perft_timer;
     init_timer(&perft_timer);
     start_timer(&perft_timer);
     uint64_t nodes;
-    if (div) {
-        nodes = divide(position, depth);
+    if (div || (options.num_threads > 1 && depth > 1)) {
+        nodes = divide(&pos, depth, div);
     } else {
-        nodes = full_search(position, depth);
+        nodes = full_search(&root_data, &pos, depth);
         printf("%"PRIu64" nodes", nodes);
     }
-    stop_timer(&perft_timer);
-    printf(", elapsed time %d ms\n", elapsed_time(&perft_timer));
+    int time = stop_timer(&perft_timer);
+    printf(", elapsed time %d ms, %"PRIu64" nps\n",
+            time, nodes*1000/MAX(time, 1));
     return nodes;
 }
 
 /*
- * Print the number of nodes descended from each legal move in the given
- * position at depth |depth|, returning the total number of nodes.
+ * Count the nodes descended from each legal move in the given position at
+ * depth |depth|, returning the total number of nodes. If |print| is set,
+ * the count for each move is printed.
  */
-static uint64_t divide(position_t* pos, int depth)
+static uint64_t divide(position_t* pos, int depth, bool print)
 {
     move_t move_list[256];
-    move_t* current_move = move_list;
-    int num_moves = 0;
-    move_selector_t selector;
-    init_move_selector(&selector, pos, PV_GEN, NULL, NO_MOVE, 0, 0);
-    for (move_t move = select_move(&selector); move != NO_MOVE;
-            move = select_move(&selector), ++num_moves) {
-        move_list[num_moves] = move;
+    uint64_t child_nodes[256];
+    int num_moves = perft_moves(&root_data, pos, move_list);
+
+    if (options.num_threads > 1 && depth > 1) {
+        parallel_perft(pos, depth, move_list, num_moves, child_nodes);
+    } else {
+        for (int i=0; i<num_moves; ++i) {
+            undo_info_t undo;
+            do_move(pos, move_list[i], &undo);
+            child_nodes[i] = full_search(&root_data, pos, depth-1);
+            undo_move(pos, move_list[i], &undo);
+        }
     }
-    move_list[num_moves] = NO_MOVE;
 
-    uint64_t child_nodes, total_nodes=0;
+    uint64_t total_nodes=0;
     char coord_move[7];
-    while (*current_move) {
-        undo_info_t undo;
-        do_move(pos, *current_move, &undo);
-        child_nodes = full_search(pos, depth-1);
-        total_nodes += child_nodes;
-        undo_move(pos, *current_move, &undo);
-        move_to_coord_str(*current_move, coord_move);
-        printf("%s: %8"PRIu64"\n", coord_move, child_nodes);
-        ++current_move;
+    for (int i=0; i<num_moves; ++i) {
+        total_nodes += child_nodes[i];
+        if (!print) continue;
+        move_to_coord_str(move_list[i], coord_move);
+        printf("%s: %8"PRIu64"\n", coord_move, child_nodes[i]);
     }
-    printf("%d moves, %"PRIu64" nodes", num_moves, total_nodes);
+    if (print) printf("%d moves, %"PRIu64" nodes", num_moves, total_nodes);
+    else printf("%"PRIu64" nodes", total_nodes);
     return total_nodes;
 }
 
 /*
- * Do a full search of the position tree rooted at |pos|, to depth |depth|.
- * This does no evaluation whatsoever, it just counts nodes.
+ * Fill |moves| with all legal moves in |pos|, in move selection order, and
+ * return the number of moves.
  */
-static uint64_t full_search(position_t* pos, int depth)
+static int perft_moves(search_data_t* data, position_t* pos, move_t* moves)
 {
-    if (depth <= 0) return 1;
-    move_t move_list[256];
-    move_t* current_move = move_list;
     int num_moves = 0;
     move_selector_t selector;
-    init_move_selector(&selector, pos, PV_GEN, NULL, NO_MOVE, 0, 0);
+    init_move_selector(&selector, data, pos, PV_GEN,
+            NULL, NO_MOVE, 0, 0);
     for (move_t move = select_move(&selector); move != NO_MOVE;
             move = select_move(&selector), ++num_moves) {
-        move_list[num_moves] = move;
+        moves[num_moves] = move;
     }
-    move_list[num_moves] = NO_MOVE;
+    moves[num_moves] = NO_MOVE;
+    return num_moves;
+}
 
-    if (depth == 1) return num_moves;
+/*
+ * Do a full search of the position tree rooted at |pos|, to depth |depth|.
+ * This does no evaluation whatsoever, it just counts nodes.
+ */
+static uint64_t full_search(search_data_t* data, position_t* pos, int depth)
+{
+    if (depth <= 0) return 1;
+    move_t move_list[256];
+    // At depth 1 we only need the number of legal moves, so skip move
+    // ordering and making each move.
+    if (depth == 1) return generate_legal_moves(pos, move_list);
 
     uint64_t nodes = 0;
-    while (*current_move) {
+    if (probe_perft_table(pos->hash, depth, &nodes)) return nodes;
+    perft_moves(data, pos, move_list);
+    for (move_t* current_move = move_list; *current_move; ++current_move) {
         undo_info_t undo;
         do_move(pos, *current_move, &undo);
-        nodes += full_search(pos, depth-1);
+        nodes += full_search(data, pos, depth-1);
         undo_move(pos, *current_move, &undo);
-        ++current_move;
     }
+    store_perft_table(pos->hash, depth, nodes);
     return nodes;
 }
-
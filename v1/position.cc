@@ -358,7 +358,9 @@ bool is_plausible_move_legal(position_t* pos, move_t move)
     square_t to = get_move_to(move);
     square_t from = get_move_from(move);
     color_t side = piece_color(piece);
-    // Make sure source and destination squares are legal.
+    // Make sure the move belongs to the side to move, and that source and
+    // destination squares are legal.
+    if (side != pos->side_to_move) return false;
     if (pos->board[from] != piece) return false;
     if (pos->board[to] != capture && !is_move_enpassant(move)) return false;
 
@@ -370,6 +372,13 @@ bool is_plausible_move_legal(position_t* pos, move_t move)
         }
     }
 
+    // Hash moves may come from a different position with the same key, or
+    // from a concurrent write by another search thread. Check the pawn
+    // move conditions that depend on more than the piece and its target.
+    if (is_move_enpassant(move) && to != pos->ep_square) return false;
+    if (piece_type(piece) == PAWN && abs(to - from) == 2*N &&
+            pos->board[(to + from)/2] != EMPTY) return false;
+
     square_t my_king_home = king_home + side*A8;
     if (!options.chess960) {
         if (is_move_castle_short(move) && !(has_oo_rights(pos, side) &&
@@ -463,16 +472,20 @@ bool is_pseudo_move_legal(position_t* pos, move_t move)
             square_t my_qr = queen_rook_home + A8*pos->side_to_move;
             assert(pos->board[my_qr] == my_r);
             pos->board[my_qr] = EMPTY;
+            clear_sq_bit(pos->color_bb[side], my_qr);
             bool castle_ok = !is_square_attacked(pos, to, flip_color(side));
             pos->board[my_qr] = my_r;
+            set_sq_bit(pos->color_bb[side], my_qr);
             return castle_ok;
         }
         assert(is_move_castle_short(move));
         square_t my_kr = king_rook_home + A8*pos->side_to_move;
         assert(pos->board[my_kr] == my_r);
         pos->board[my_kr] = EMPTY;
+        clear_sq_bit(pos->color_bb[side], my_kr);
         bool castle_ok = !is_square_attacked(pos, to, flip_color(side));
         pos->board[my_kr] = my_r;
+        set_sq_bit(pos->color_bb[side], my_kr);
         return castle_ok;
     }
     if (piece_is_type(piece, KING)) return !is_square_attacked(pos, to, flip_color(side));
@@ -493,6 +506,45 @@ bool is_pseudo_move_legal(position_t* pos, move_t move)
     return true;
 }
 
+/*
+ * Test a pseudo-legal move's legality using the checks and pins already
+ * found in |ci|. Only king moves and en passant captures need to look at the
+ * board; everything else is a few mask tests.
+ */
+bool is_pseudo_move_legal_ci(position_t* pos,
+        const check_info_t* ci,
+        move_t move)
+{
+    if (!move) return false;
+    int from = square_to_index(get_move_from(move));
+    int to = square_to_index(get_move_to(move));
+    color_t side = pos->side_to_move;
+    bitboard_t occupied = occupied_squares(pos);
+    bitboard_t enemies = pos->color_bb[side^1];
+    bool legal;
+    if (from == ci->king_ind) {
+        if (options.chess960 && is_move_castle(move)) {
+            legal = is_pseudo_move_legal(pos, move);
+        } else {
+            legal = !(attackers_to(pos, to, occupied ^ set_mask[from]) &
+                    enemies);
+        }
+    } else if (is_move_enpassant(move)) {
+        int captured = square_to_index(get_move_to(move) - pawn_push[side]);
+        occupied ^= set_mask[from] | set_mask[captured] | set_mask[to];
+        legal = !(attackers_to(pos, ci->king_ind, occupied) &
+                enemies & ~set_mask[captured]);
+    } else {
+        legal = (!(ci->pinned & set_mask[from]) ||
+                (line_mask[ci->king_ind][from] & set_mask[to])) &&
+            (!ci->checkers || (!(ci->checkers & (ci->checkers - 1)) &&
+                (set_mask[to] & (ci->checkers |
+                    between_mask[ci->king_ind][first_bit(ci->checkers)]))));
+    }
+    assert2(legal == is_pseudo_move_legal(pos, move));
+    return legal;
+}
+
 /*
  * Detect if the current position is a repetition of earlier game
  * positions.
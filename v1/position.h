@@ -17,6 +17,8 @@ typedef struct {
     int num_pieces[2];
     int num_pawns[2];
     int piece_count[16];
+    bitboard_t piece_bb[16];            // squares holding each piece
+    bitboard_t color_bb[2];             // squares holding each side's pieces
     color_t side_to_move;
     move_t prev_move;
     square_t ep_square;
@@ -33,6 +35,22 @@ typedef struct {
     hashkey_t hash_history[HASH_HISTORY_LENGTH];
 } position_t;
 
+#define occupied_squares(pos) \
+    ((pos)->color_bb[WHITE] | (pos)->color_bb[BLACK])
+
+// Checks and pins relative to the side to move, computed once per node by
+// |init_check_info| so that legality tests and check generation don't have
+// to rediscover them for every move. A pinned piece may only move along
+// |line_mask[king_ind][from]|.
+typedef struct {
+    bitboard_t checkers;                // enemy pieces checking our king
+    bitboard_t pinned;                  // our pieces pinned to our king
+    bitboard_t discoverers;             // our pieces that can discover check
+    bitboard_t check_squares[KING+1];   // squares each piece type checks from
+    int king_ind;
+    int their_king_ind;
+} check_info_t;
+
 typedef struct {
     uint8_t is_check;
     square_t check_square;
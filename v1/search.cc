@@ -31,41 +31,99 @@ static const int iid_nonpv_margin = 150;
 static const bool obvious_move_enabled = true;
 static const int obvious_move_margin = 250;
 
+static const float min_split_depth = 4.0;
+static const float abdada_min_depth = 3.0;
+
 static const int qfutility_margin = 65;
+static const int qcheck_margin = 150;
 static const int razor_margin[] = { 300, 300, 300, 325 };
 static const int razor_qmargin[] = { 125, 125, 300, 300 };
 
 static search_result_t root_search(search_data_t* search_data,
         int alpha,
         int beta);
-static int search(position_t* pos,
+static int search(search_data_t* data,
+        position_t* pos,
+        search_node_t* search_node,
+        int ply,
+        int alpha,
+        int beta,
+        float depth);
+static int search_pv(search_data_t* data,
+        position_t* pos,
+        search_node_t* search_node,
+        int ply,
+        int alpha,
+        int beta,
+        float depth);
+static int search_nonpv(search_data_t* data,
+        position_t* pos,
         search_node_t* search_node,
         int ply,
         int alpha,
         int beta,
         float depth);
-static int quiesce(position_t* pos,
+static int quiesce(search_data_t* data,
+        position_t* pos,
         search_node_t* search_node,
         int ply,
         int alpha,
         int beta,
         float depth);
-static uint64_t get_root_node_count(move_t move);
+static uint64_t get_root_node_count(search_data_t* data, move_t move);
 
 /*
  * Zero out all search variables prior to starting a search. Leaves the
- * position and search options untouched.
+ * position, search options, and hash tables untouched. Tables that haven't
+ * been set yet default to the engine's global tables.
  */
 void init_search_data(search_data_t* data)
 {
     position_t root_pos_copy;
     copy_position(&root_pos_copy, &data->root_pos);
+    transposition_table_t* trans_table = data->trans_table;
+    pawn_table_t* pawn_table = data->pawn_table;
+    material_table_t* material_table = data->material_table;
+    eval_table_t* eval_table = data->eval_table;
+    pv_cache_t* pv_cache = data->pv_cache;
+    bool silent = data->silent;
     memset(data, 0, sizeof(search_data_t));
     copy_position(&data->root_pos, &root_pos_copy);
+    data->trans_table = trans_table ? trans_table : &default_trans_table;
+    data->pawn_table = pawn_table ? pawn_table : &default_pawn_table;
+    data->material_table = material_table ?
+        material_table : &default_material_table;
+    data->eval_table = eval_table ? eval_table : &default_eval_table;
+    data->pv_cache = pv_cache ? pv_cache : &default_pv_cache;
+    data->silent = silent;
     data->engine_status = ENGINE_IDLE;
     init_timer(&data->timer);
 }
 
+/*
+ * Make |move| on |pos| and prefetch the hash table entries that the search
+ * of the resulting position will probe. The transposition table and eval
+ * cache are probed at nearly every node; the pawn and material entries only
+ * change when pawns move or material comes off, so those are only fetched
+ * when they're needed.
+ */
+static void do_search_move(search_data_t* data,
+        position_t* pos,
+        move_t move,
+        undo_info_t* undo)
+{
+    do_move(pos, move, undo);
+    prefetch_transposition(data->trans_table, pos->hash);
+    prefetch_eval_entry(data->eval_table, pos->hash);
+    if (piece_type(get_move_piece(move)) == PAWN ||
+            get_move_capture_type(move) == PAWN) {
+        prefetch_pawn_data(data->pawn_table, pos->pawn_hash);
+    }
+    if (get_move_capture(move) != EMPTY || get_move_promote(move)) {
+        prefetch_material_data(data->material_table, pos->material_hash);
+    }
+}
+
 /*
  * Copy pv from a deeper search node, adding a new move at the current ply.
  */
@@ -79,28 +137,40 @@ static void update_pv(move_t* dst, move_t* src, int ply, move_t move)
     } while (src[i] != NO_MOVE);
 }
 
+/*
+ * Check for user input and time limits, and periodically print search info.
+ * Only the main thread polls; helper threads are stopped by the main thread
+ * when it finishes. Silent searches only check their limits.
+ */
+static void poll_for_input(search_data_t* data)
+{
+    assert(data->thread_id == 0);
+    if (should_stop_searching(data)) data->engine_status = ENGINE_ABORTED;
+    if (data->silent) return;
+    uci_check_for_command();
+    int so_far = elapsed_time(&data->timer);
+    if (so_far < 1000) {
+        data->last_info_time = 0;
+    } else if (so_far - data->last_info_time > 1000) {
+        data->last_info_time = so_far;
+        uint64_t nodes = total_nodes_searched(data);
+        uint64_t nps = nodes/so_far*1000;
+        printf("info time %d nodes %"PRIu64, so_far, nodes);
+        if (options.verbosity > 1) printf(" qnodes %"PRIu64" pvnodes %"
+                PRIu64, data->qnodes_searched, data->pvnodes_searched);
+        printf(" nps %"PRIu64" hashfull %d\n", nps,
+                get_hashfull(data->trans_table));
+    }
+}
+
 /*
  * Every time a node is expanded, increment the node counter. Every
  * POLL_INTERVAL nodes, check for user input.
  */
 static void open_node(search_data_t* data, int ply)
 {
-    if ((++data->nodes_searched & POLL_INTERVAL) == 0) {
-        if (should_stop_searching(data)) data->engine_status = ENGINE_ABORTED;
-        uci_check_for_command();
-        int so_far = elapsed_time(&data->timer);
-        static int last_info = 0;
-        if (so_far < 1000) {
-            last_info = 0;
-        } else if (so_far - last_info > 1000) {
-            last_info = so_far;
-            uint64_t nps = data->nodes_searched/so_far*1000;
-            printf("info time %d nodes %"PRIu64, so_far, data->nodes_searched);
-            if (options.verbosity > 1) printf(" qnodes %"PRIu64" pvnodes %"
-                    PRIu64, data->qnodes_searched, data->pvnodes_searched);
-            printf(" nps %"PRIu64" hashfull %d\n", nps, get_hashfull());
-        }
-    }
+    if ((++data->nodes_searched & POLL_INTERVAL) == 0 &&
+            data->thread_id == 0) poll_for_input(data);
     data->search_stack[ply].killers[0] = NO_MOVE;
     data->search_stack[ply].killers[1] = NO_MOVE;
     data->search_stack[ply].mate_killer = NO_MOVE;
@@ -198,7 +268,7 @@ static bool should_deepen(search_data_t* data)
     if (obvious_move_enabled && data->obvious_move &&
             data->depth_limit == MAX_SEARCH_PLY &&
             !data->node_limit && data->current_depth >= 7*PLY &&
-            get_root_node_count(data->obvious_move) >
+            get_root_node_count(data, data->obvious_move) >
             data->nodes_searched * 10 / 9) return false;
 
     // Allocate some extra time when the root score drops.
@@ -222,7 +292,8 @@ static bool should_deepen(search_data_t* data)
  * function provides a unified interface for calls to Scorpio bitbases and
  * Gaviota tablebases.
  */
-static bool check_eg_database(position_t* pos,
+static bool check_eg_database(search_data_t* data,
+        position_t* pos,
         float depth,
         int ply,
         int alpha,
@@ -231,16 +302,16 @@ static bool check_eg_database(position_t* pos,
 {
     // Bail out if there are too many pieces on the board or if time
     // constraints are an issue.
-    if ((root_data.time_limit && root_data.time_limit < 500) ||
+    if ((data->time_limit && data->time_limit < 500) ||
             pos->num_pieces[WHITE] + pos->num_pieces[BLACK] +
             pos->num_pawns[WHITE] + pos->num_pawns[BLACK] >
             options.max_egtb_pieces) return false;
     if (options.use_gtb) {
         // TODO: figure out when to use dtm instead of wdl.
         bool success = false;
-        if (options.root_in_gtb) {
+        if (data->root_in_gtb) {
             success = probe_gtb_hard_dtm(pos, score);
-        } else if (options.use_gtb_dtm) {
+        } else if (data->use_gtb_dtm) {
             if (options.nonblocking_gtb) {
                 success = probe_gtb_firm_dtm(pos, score);
             } else {
@@ -254,7 +325,7 @@ static bool check_eg_database(position_t* pos,
             }
         }
         if (success) {
-            ++root_data.stats.egbb_hits;
+            ++data->stats.egbb_hits;
             return true;
         }
     } else if (options.use_scorpio_bb) {
@@ -264,7 +335,7 @@ static bool check_eg_database(position_t* pos,
         if (pos->fifty_move_counter != 0 &&
                 (ply <= 2*(depth_to_index(depth) + ply)/3)) return false;
         if (probe_scorpio_bb(pos, score, ply)) {
-            ++root_data.stats.egbb_hits;
+            ++data->stats.egbb_hits;
             return true;
         }
     }
@@ -304,13 +375,13 @@ static void store_root_data(search_data_t* data,
 /*
  * Get number of nodes searched for a root move in the last iteration.
  */
-static uint64_t get_root_node_count(move_t move)
+static uint64_t get_root_node_count(search_data_t* data, move_t move)
 {
     int i;
-    for (i=0; root_data.root_moves[i].move != move &&
-            root_data.root_moves[i].move != NO_MOVE; ++i) {}
-    assert(root_data.root_moves[i].move == move);
-    return root_data.root_moves[i].nodes;
+    for (i=0; data->root_moves[i].move != move &&
+            data->root_moves[i].move != NO_MOVE; ++i) {}
+    assert(data->root_moves[i].move == move);
+    return data->root_moves[i].nodes;
 }
 
 /*
@@ -348,6 +419,205 @@ static bool is_history_prune_allowed(history_t* h, move_t move, int depth)
     return depth * h->success[index] < h->failure[index];
 }
 
+/*
+ * Update history and killers after |move| causes a cutoff. All the other
+ * moves in |searched_moves| failed to cut off.
+ */
+static void record_cutoff(search_data_t* data,
+        search_node_t* search_node,
+        move_t move,
+        int score,
+        float depth,
+        move_t* searched_moves,
+        int num_searched_moves)
+{
+    if (!get_move_capture(move) &&
+            !get_move_promote(move)) {
+        record_success(&data->history, move, depth);
+        for (int i=0; i<num_searched_moves; ++i) {
+            move_t m = searched_moves[i];
+            if (m == move) continue;
+            if (!get_move_capture(m) && !get_move_promote(m)) {
+                record_failure(&data->history, m, depth);
+            }
+        }
+        if (move != search_node->killers[0]) {
+            search_node->killers[1] = search_node->killers[0];
+            search_node->killers[0] = move;
+        }
+    }
+    if (is_mate_score(score) && score > 0) {
+        search_node->mate_killer = move;
+    }
+}
+
+/*
+ * Can |move| be skipped by futility pruning? Note: it would be nice to do
+ * extensions and futility before calling do_move, but this would require
+ * more efficient ways of identifying important moves without actually
+ * making them. |move| has already been made in |pos|.
+ */
+static bool is_move_futile(search_data_t* data,
+        position_t* pos,
+        move_selector_t* sel,
+        move_t move,
+        float ext,
+        bool mate_threat,
+        bool full_window,
+        float depth,
+        int lazy_score,
+        int beta,
+        int num_legal_moves)
+{
+    const bool prune_futile = futility_enabled &&
+        !full_window &&
+        !ext &&
+        !mate_threat &&
+        depth <= futility_depth_limit &&
+        !is_check(pos) &&
+        num_legal_moves >= depth_to_index(depth) + 2 &&
+        should_try_prune(sel, move);
+    if (!prune_futile) return false;
+
+    // History pruning.
+    // TODO: try more stringent depth requirements
+    // TODO: try pruning based on pure move ordering, or work
+    // move order into the history count
+    // TODO: experiment with pruning inside pv
+    if (history_prune_enabled && depth <= 3.0 &&
+            is_history_prune_allowed(&data->history, move, depth)) {
+        return true;
+    }
+    // Value pruning.
+    if (value_prune_enabled &&
+            lazy_score +
+            material_value(get_move_capture(move)) +
+            85 + 15*depth + 2*depth*depth <
+            beta + 2*num_legal_moves) return true;
+    return false;
+}
+
+/*
+ * Has the search been stopped, or has a cutoff at any split point we're
+ * working under made our results irrelevant?
+ */
+static bool is_search_aborted(search_data_t* data)
+{
+    if (data->engine_status == ENGINE_ABORTED) return true;
+    for (split_point_t* sp = data->split_point; sp; sp = sp->parent) {
+        if (sp->cancelled ||
+                sp->master->engine_status == ENGINE_ABORTED) return true;
+    }
+    return false;
+}
+
+/*
+ * Should we split the current node? We only split when using the young
+ * brothers wait algorithm, and only if there's enough depth left to be
+ * worth the overhead.
+ */
+static bool should_split(search_data_t* data, float depth)
+{
+    return options.parallel_algorithm == PARALLEL_YBW &&
+        depth >= min_split_depth &&
+        idle_helper_available() &&
+        !is_search_aborted(data);
+}
+
+/*
+ * Search the remaining moves at |sp|. This is called by the thread that
+ * created the split point and by each helper assigned to it.
+ */
+void search_split_point(search_data_t* data, split_point_t* sp)
+{
+    split_point_t* parent = data->split_point;
+    data->split_point = sp;
+    // Selecting a move can briefly make and unmake it on |sp->pos|, so the
+    // position is only copied under the lock.
+    position_t pos;
+    lock_mutex(&sp->lock);
+    copy_position(&pos, &sp->pos);
+    unlock_mutex(&sp->lock);
+    search_node_t* search_node = &data->search_stack[sp->ply-1];
+    const int ply = sp->ply;
+    const float depth = sp->depth;
+    int num_legal_moves;
+    float lmr_red;
+    move_t move;
+    while (!is_search_aborted(data) &&
+            (move = select_shared_move(sp->selector, sp->full_window,
+                                       &num_legal_moves, &lmr_red))) {
+        int alpha = sp->alpha;
+        undo_info_t undo;
+        do_search_move(data, &pos, move, &undo);
+        float ext = extend(&pos, move, sp->single_reply, sp->full_window);
+        if (is_move_futile(data, &pos, sp->selector, move, ext,
+                    sp->mate_threat, sp->full_window, depth,
+                    sp->lazy_score, sp->beta, num_legal_moves)) {
+            undo_move(&pos, move, &undo);
+            continue;
+        }
+        const bool try_lmr = lmr_enabled &&
+            !ext &&
+            !sp->mate_threat &&
+            depth > lmr_depth_limit;
+        int score = alpha+1;
+        if (try_lmr && lmr_red) score = -search(data, &pos, search_node+1,
+                ply+1, -alpha-1, -alpha, depth-lmr_red-PLY);
+        if (score > alpha) {
+            score = -search(data, &pos, search_node+1, ply+1,
+                    -alpha-1, -alpha, depth+ext-PLY);
+            if (score > alpha) score = -search(data, &pos, search_node+1,
+                    ply+1, -sp->beta, -alpha, depth+ext-PLY);
+        }
+        undo_move(&pos, move, &undo);
+        if (is_search_aborted(data)) break;
+
+        lock_mutex(&sp->lock);
+        sp->searched_moves[sp->num_searched_moves++] = move;
+        if (score > sp->alpha) {
+            sp->alpha = score;
+            sp->best_move = move;
+            update_pv(sp->pv, (search_node+1)->pv, ply, move);
+            if (score >= sp->beta) sp->cancelled = true;
+        }
+        unlock_mutex(&sp->lock);
+    }
+    data->split_point = parent;
+}
+
+/*
+ * Share the remaining moves at a node with all idle helpers, and search
+ * them until they're exhausted or one of them causes a cutoff. The caller
+ * fills in the search parameters of |sp|; results are returned in
+ * |sp->alpha|, |sp->best_move|, and |sp->pv|.
+ */
+static void split(search_data_t* data, split_point_t* sp)
+{
+    init_mutex(&sp->lock);
+    sp->parent = data->split_point;
+    sp->cancelled = false;
+    sp->best_move = NO_MOVE;
+    sp->selector->pos = &sp->pos;
+    sp->selector->lock = &sp->lock;
+    assign_split_point_helpers(sp);
+
+    search_split_point(data, sp);
+    // Wait for helpers to finish. The main thread still has to watch the
+    // clock while it waits. Helpers decrement the worker count under the
+    // lock, so reading it under the lock too means the last helper has
+    // released the lock, and is done with |sp|, before we destroy it.
+    while (true) {
+        lock_mutex(&sp->lock);
+        int num_workers = sp->num_workers;
+        unlock_mutex(&sp->lock);
+        if (!num_workers) break;
+        if (data->thread_id == 0) poll_for_input(data);
+        yield_thread();
+    }
+    destroy_mutex(&sp->lock);
+}
+
 /*
  * Can we do internal iterative deepening?
  */
@@ -371,7 +641,8 @@ static bool is_trans_cutoff_allowed(transposition_entry_t* entry,
         int* alpha,
         int* beta)
 {
-    if (depth > entry->depth && !is_mate_score(entry->score)) return false;
+    if (depth * TT_DEPTH_SCALE > entry->depth &&
+            !is_mate_score(entry->score)) return false;
     if (entry->flags & SCORE_LOWERBOUND && entry->score > *alpha) {
         *alpha = entry->score;
     }
@@ -384,15 +655,15 @@ static bool is_trans_cutoff_allowed(transposition_entry_t* entry,
 /*
  * Initialize a move at the root with the score of its depth-1 search.
  */
-void init_root_move(root_move_t* root_move, move_t move)
+void init_root_move(search_data_t* data, root_move_t* root_move, move_t move)
 {
     memset(root_move, 0, sizeof(root_move_t));
     root_move->move = move;
     undo_info_t undo;
-    do_move(&root_data.root_pos, move, &undo);
-    root_move->qsearch_score = -quiesce(&root_data.root_pos,
-            root_data.search_stack, 1, mated_in(-1), mate_in(-1), 0.0);
-    undo_move(&root_data.root_pos, move, &undo);
+    do_move(&data->root_pos, move, &undo);
+    root_move->qsearch_score = -quiesce(data, &data->root_pos,
+            data->search_stack, 1, mated_in(-1), mate_in(-1), 0.0);
+    undo_move(&data->root_pos, move, &undo);
     root_move->pv[0] = move;
 }
 
@@ -415,20 +686,53 @@ void find_obvious_move(search_data_t* data)
     for (int i=0; r[i].move; ++i) {
         if (r[i].move == data->obvious_move) continue;
         if (r[i].qsearch_score + obvious_move_margin > best_score) {
-            if (options.verbosity && data->engine_status != ENGINE_PONDERING) {
+            if (options.verbosity && !data->silent &&
+                    data->engine_status != ENGINE_PONDERING) {
                 printf("info string no obvious move\n");
             }
             data->obvious_move = NO_MOVE;
             return;
         }
     }
-    if (options.verbosity && data->engine_status != ENGINE_PONDERING) {
+    if (options.verbosity && !data->silent &&
+            data->engine_status != ENGINE_PONDERING) {
         printf("info string candidate obvious move ");
         print_coord_move(data->obvious_move);
         printf("\n");
     }
 }
 
+/*
+ * Calculate the aspiration window for the next iteration, based on the
+ * score of the last iteration and the number of consecutive fail highs and
+ * lows we've seen at the root.
+ */
+static void aspiration_window(search_data_t* data,
+        int consecutive_fail_lows,
+        int consecutive_fail_highs,
+        int* alpha,
+        int* beta)
+{
+    static const int aspire_low[] = { -35, -75, -300 };
+    static const int aspire_high[] = { 35, 75, 300 };
+    int last_score =
+        data->scores_by_iteration[depth_to_index(data->current_depth)-1];
+    *alpha = mated_in(-1);
+    *beta = mate_in(-1);
+    if (data->current_depth > 5*PLY && options.multi_pv == 1) {
+        *alpha = consecutive_fail_lows > 2 ||
+            last_score < -MIN_MATE_VALUE+MAX_SEARCH_PLY ? mated_in(-1) :
+            last_score + aspire_low[consecutive_fail_lows];
+        *beta = consecutive_fail_highs > 2 ||
+            last_score > MIN_MATE_VALUE - MAX_SEARCH_PLY ?  mate_in(-1) :
+            last_score + aspire_high[consecutive_fail_highs];
+        if (options.verbosity && data->thread_id == 0 && !data->silent) {
+            printf("info string aspiration window alpha %d beta %d\n",
+                    *alpha, *beta);
+        }
+    }
+}
+
 /*
  * Iterative deepening search of the root position. This is the external
  * function that is called by the console interface. For each depth,
@@ -437,13 +741,14 @@ void find_obvious_move(search_data_t* data)
 void deepening_search(search_data_t* search_data, bool ponder)
 {
     search_data->engine_status = ponder ? ENGINE_PONDERING : ENGINE_THINKING;
-    increment_transposition_age();
+    increment_transposition_age(search_data->trans_table);
     init_timer(&search_data->timer);
     start_timer(&search_data->timer);
 
     // Get a move out of the opening book if we can.
     if (options.use_book &&
             options.book_loaded &&
+            !search_data->silent &&
             !search_data->infinite &&
             !search_data->depth_limit &&
             !search_data->node_limit &&
@@ -460,10 +765,11 @@ void deepening_search(search_data_t* search_data, bool ponder)
     }
 
     position_t* pos = &search_data->root_pos;
-    options.root_in_gtb = (pos->num_pieces[WHITE] + pos->num_pieces[BLACK] +
-            pos->num_pawns[WHITE] + pos->num_pawns[BLACK] <=
-            options.max_egtb_pieces && options.use_gtb);
-    options.use_gtb_dtm = false;
+    search_data->root_in_gtb = (pos->num_pieces[WHITE] +
+            pos->num_pieces[BLACK] + pos->num_pawns[WHITE] +
+            pos->num_pawns[BLACK] <= options.max_egtb_pieces &&
+            options.use_gtb);
+    search_data->use_gtb_dtm = false;
 
     // If |search_data| already has a list of root moves, we search only
     // those moves. Otherwise, search everything. This allows support for the
@@ -472,45 +778,34 @@ void deepening_search(search_data_t* search_data, bool ponder)
         move_t moves[256];
         generate_legal_moves(pos, moves);
         for (int i=0; moves[i]; ++i) {
-            init_root_move(&search_data->root_moves[i], moves[i]);
+            init_root_move(search_data, &search_data->root_moves[i],
+                    moves[i]);
         }
     }
     find_obvious_move(search_data);
 
-    int id_score = root_data.best_score = mated_in(-1);
+    int id_score = search_data->best_score = mated_in(-1);
     int consecutive_fail_highs = 0;
     int consecutive_fail_lows = 0;
     if (!search_data->depth_limit) {
         search_data->depth_limit = MAX_SEARCH_PLY * PLY;
     }
+    if (!search_data->silent) start_helper_threads(search_data);
     for (search_data->current_depth=2*PLY;
             search_data->current_depth <= search_data->depth_limit;
             search_data->current_depth += PLY) {
         float depth = search_data->current_depth;
         int depth_index = depth_to_index(depth);
         if (should_output(search_data)) {
-            if (options.verbosity > 1) print_transposition_stats();
+            if (options.verbosity > 1) {
+                print_transposition_stats(search_data->trans_table);
+            }
             printf("info depth %d\n", depth_index);
         }
 
-        // Calculate aspiration search window.
-        int alpha = mated_in(-1);
-        int beta = mate_in(-1);
-        int last_score = search_data->scores_by_iteration[depth_index-1];
-        static int aspire_low[] = { -35, -75, -300 };
-        static int aspire_high[] = { 35, 75, 300 };
-        if (depth > 5*PLY && options.multi_pv == 1) {
-            alpha = consecutive_fail_lows > 2 ||
-                last_score < -MIN_MATE_VALUE+MAX_SEARCH_PLY ? mated_in(-1) :
-                last_score + aspire_low[consecutive_fail_lows];
-            beta = consecutive_fail_highs > 2 ||
-                last_score > MIN_MATE_VALUE - MAX_SEARCH_PLY ?  mate_in(-1) :
-                last_score + aspire_high[consecutive_fail_highs];
-            if (options.verbosity) {
-                printf("info string aspiration window alpha %d beta %d\n",
-                        alpha, beta);
-            }
-        }
+        int alpha, beta;
+        aspiration_window(search_data, consecutive_fail_lows,
+                consecutive_fail_highs, &alpha, &beta);
         search_data->root_indecisiveness = 0;
 
         search_result_t result = root_search(search_data, alpha, beta);
@@ -520,7 +815,8 @@ void deepening_search(search_data_t* search_data, bool ponder)
         score_type_t score_type = SCORE_EXACT;
         if (result == SEARCH_FAIL_LOW) score_type = SCORE_UPPERBOUND;
         else if (result == SEARCH_FAIL_HIGH) score_type = SCORE_LOWERBOUND;
-        put_transposition_line(pos,
+        put_transposition_line(search_data->trans_table,
+                pos,
                 search_data->pv,
                 depth,
                 search_data->best_score,
@@ -546,28 +842,33 @@ void deepening_search(search_data_t* search_data, bool ponder)
             consecutive_fail_lows = 0;
             consecutive_fail_highs = 0;
         }
-        options.use_gtb_dtm = (id_score < -MIN_MATE_VALUE + MAX_SEARCH_PLY ||
-                id_score > MIN_MATE_VALUE - MAX_SEARCH_PLY);
+        search_data->use_gtb_dtm =
+            (id_score < -MIN_MATE_VALUE + MAX_SEARCH_PLY ||
+             id_score > MIN_MATE_VALUE - MAX_SEARCH_PLY);
 
         if (!should_deepen(search_data)) {
             search_data->current_depth += PLY;
             break;
         }
     }
+    stop_helper_threads();
     stop_timer(&search_data->timer);
     if (search_data->engine_status == ENGINE_PONDERING) uci_wait_for_command();
 
     search_data->current_depth -= PLY;
     search_data->best_score = id_score;
+    search_data->engine_status = ENGINE_IDLE;
+    if (search_data->silent) return;
     if (options.verbosity > 1) {
         print_search_stats(search_data);
         printf("info string time target %d time limit %d elapsed time %d\n",
                 search_data->time_target,
                 search_data->time_limit,
                 elapsed_time(&search_data->timer));
-        print_transposition_stats();
-        print_pawn_stats();
-        print_pv_cache_stats();
+        print_transposition_stats(search_data->trans_table);
+        print_pawn_stats(search_data->pawn_table);
+        print_eval_stats(search_data->eval_table);
+        print_pv_cache_stats(search_data->pv_cache);
         print_multipv(search_data);
     }
     char best_move[7], ponder_move[7];
@@ -577,7 +878,65 @@ void deepening_search(search_data_t* search_data, bool ponder)
     printf("bestmove %s", best_move);
     if (search_data->pv[1]) printf(" ponder %s", ponder_move);
     printf("\n");
-    search_data->engine_status = ENGINE_IDLE;
+}
+
+/*
+ * Iterative deepening loop run by each helper thread in parallel with the
+ * main search. Helpers share only the transposition table with the main
+ * thread. To keep them from duplicating its work, with lazy smp each helper
+ * skips a different subset of depths; with ABDADA all threads search every
+ * depth, and instead defer moves that another thread is already searching.
+ * Helpers never report results or manage time, they just run until the
+ * main thread aborts them.
+ */
+void helper_deepening_search(search_data_t* data)
+{
+    static const int skip_size[] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3,
+        4, 4, 4, 4, 4, 4, 4, 4 };
+    static const int skip_phase[] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5,
+        0, 1, 2, 3, 4, 5, 6, 7 };
+    const int skip = (data->thread_id - 1) % 20;
+    int consecutive_fail_highs = 0;
+    int consecutive_fail_lows = 0;
+    data->best_score = mated_in(-1);
+    for (data->current_depth=2*PLY;
+            data->current_depth <= data->depth_limit;
+            data->current_depth += PLY) {
+        int depth_index = depth_to_index(data->current_depth);
+        if (options.parallel_algorithm == PARALLEL_LAZY_SMP &&
+                (depth_index + skip_phase[skip]) / skip_size[skip] % 2) {
+            data->scores_by_iteration[depth_index] =
+                data->scores_by_iteration[depth_index-1];
+            continue;
+        }
+        int alpha, beta;
+        aspiration_window(data, consecutive_fail_lows,
+                consecutive_fail_highs, &alpha, &beta);
+        data->root_indecisiveness = 0;
+        search_result_t result = root_search(data, alpha, beta);
+        if (result == SEARCH_ABORTED) break;
+        int id_score = data->best_score;
+        data->scores_by_iteration[depth_index] = id_score;
+        if (id_score <= alpha) {
+            consecutive_fail_lows++;
+            consecutive_fail_highs = 0;
+        } else if (id_score >= beta) {
+            consecutive_fail_lows = 0;
+            consecutive_fail_highs++;
+        } else {
+            consecutive_fail_lows = 0;
+            consecutive_fail_highs = 0;
+        }
+    }
+}
+
+/*
+ * Nodes searched by |data| plus all helper threads.
+ */
+uint64_t total_nodes_searched(search_data_t* data)
+{
+    if (data->thread_id) return data->nodes_searched;
+    return data->nodes_searched + helper_nodes_searched();
 }
 
 /*
@@ -591,11 +950,13 @@ static search_result_t root_search(search_data_t* search_data,
     int orig_alpha = alpha;
     search_data->best_score = alpha;
     position_t* pos = &search_data->root_pos;
-    transposition_entry_t* trans_entry = get_transposition(pos);
+    transposition_entry_t trans_entry_copy;
+    transposition_entry_t* trans_entry = get_transposition(
+            search_data->trans_table, pos, &trans_entry_copy);
     move_t hash_move = trans_entry ? trans_entry->move : NO_MOVE;
 
     move_selector_t selector;
-    init_move_selector(&selector, pos, ROOT_GEN,
+    init_move_selector(&selector, search_data, pos, ROOT_GEN,
             NULL, hash_move, search_data->current_depth, 0);
     search_data->current_move_index = 0;
     search_data->resolving_fail_high = false;
@@ -615,7 +976,7 @@ static search_result_t root_search(search_data_t* search_data,
         }
         uint64_t nodes_before = search_data->nodes_searched;
         undo_info_t undo;
-        do_move(pos, move, &undo);
+        do_search_move(search_data, pos, move, &undo);
         float ext = extend(pos, move, false, true);
         float depth = search_data->current_depth;
         int score;
@@ -623,17 +984,17 @@ static search_result_t root_search(search_data_t* search_data,
         if (search_data->current_move_index < options.multi_pv) {
             // Use full window search.
             alpha = mated_in(-1);
-            score = -search(pos, search_data->search_stack,
+            score = -search(search_data, pos, search_data->search_stack,
                     1, -beta, -alpha, search_data->current_depth+ext-PLY);
         } else {
             const bool try_lmr = lmr_enabled && ext != 0 && !is_check(pos);
             int lmr_red = try_lmr ? lmr_reduction(&selector,
                     move, false) : 0;
             if (lmr_red) {
-                score = -search(pos, search_data->search_stack,
+                score = -search(search_data, pos, search_data->search_stack,
                         1, -alpha-1, -alpha, depth-lmr_red-PLY);
             } else {
-                score = -search(pos, search_data->search_stack,
+                score = -search(search_data, pos, search_data->search_stack,
                     1, -alpha-1, -alpha, search_data->current_depth+ext-PLY);
             }
             if (score > alpha) {
@@ -645,8 +1006,8 @@ static search_result_t root_search(search_data_t* search_data,
                                 coord_move);
                     }
                     search_data->resolving_fail_high = true;
-                    score = -search(pos, search_data->search_stack,
-                            1, -beta, -alpha,
+                    score = -search(search_data, pos,
+                            search_data->search_stack, 1, -beta, -alpha,
                             search_data->current_depth+ext-PLY);
                 }
             }
@@ -664,9 +1025,15 @@ static search_result_t root_search(search_data_t* search_data,
             if (score > search_data->best_score) {
                 search_data->best_score = score;
             }
+            if (move != search_data->pv[0]) {
+                search_data->best_move_time =
+                    elapsed_time(&search_data->timer);
+            }
             update_pv(search_data->pv, search_data->search_stack->pv, 0, move);
             check_line(pos, search_data->pv);
-            print_multipv(search_data);
+            if (search_data->thread_id == 0 && !search_data->silent) {
+                print_multipv(search_data);
+            }
         }
         search_data->resolving_fail_high = false;
     }
@@ -689,47 +1056,60 @@ static search_result_t root_search(search_data_t* search_data,
 }
 
 /*
- * Search an interior, non-quiescent node.
+ * Search an interior, non-quiescent node. This is only called with a
+ * constant |full_window|, so that each copy of the search keeps only the code
+ * that applies to its own node type.
  */
-static int search(position_t* pos,
+static FORCE_INLINE int search_body(search_data_t* data,
+        position_t* pos,
         search_node_t* search_node,
         int ply,
         int alpha,
         int beta,
-        float depth)
+        float depth,
+        const bool full_window)
 {
     search_node->pv[ply] = NO_MOVE;
-    if (root_data.engine_status == ENGINE_ABORTED) return 0;
-    if (depth < 0.5) return quiesce(pos, search_node, ply, alpha, beta, depth);
+    if (is_search_aborted(data)) return 0;
+    if (depth < 0.5) {
+        return quiesce(data, pos, search_node, ply, alpha, beta, depth);
+    }
 
     int orig_alpha = alpha;
     alpha = MAX(alpha, mated_in(ply));
     beta = MIN(beta, mate_in(ply));
     if (alpha >= beta) return alpha;
     if (is_draw(pos)) return DRAW_VALUE;
-    bool full_window = (beta-alpha > 1);
+    assert(full_window == (beta-alpha > 1));
 
     // Get move from transposition table if possible.
-    transposition_entry_t* trans_entry = get_transposition(pos);
+    transposition_entry_t trans_entry_copy;
+    transposition_entry_t* trans_entry =
+        get_transposition(data->trans_table, pos, &trans_entry_copy);
     move_t hash_move = trans_entry ? trans_entry->move : NO_MOVE;
     bool mate_threat = trans_entry && trans_entry->flags & MATE_THREAT;
     if (!full_window && trans_entry &&
             is_trans_cutoff_allowed(trans_entry, depth, &alpha, &beta)) {
         search_node->pv[ply] = hash_move;
         search_node->pv[ply+1] = NO_MOVE;
-        root_data.stats.transposition_cutoffs[
-            depth_to_index(root_data.current_depth)]++;
+        data->stats.transposition_cutoffs[
+            depth_to_index(data->current_depth)]++;
         return MAX(alpha, trans_entry->score);
     }
 
     int score;
     // Check endgame bitbases/tablebases if appropriate
-    if (check_eg_database(pos, depth, ply, alpha, beta, &score)) return score;
+    if (check_eg_database(data, pos, depth, ply, alpha, beta, &score)) {
+        return score;
+    }
 
-    open_node(&root_data, ply);
-    if (full_window) root_data.pvnodes_searched++;
+    open_node(data, ply);
+    if (full_window) data->pvnodes_searched++;
     score = mated_in(-1);
-    int lazy_score = simple_eval(pos);
+    eval_data_t ed;
+    init_eval_data(&ed, data->pawn_table,
+            data->material_table, data->eval_table);
+    int lazy_score = simple_eval(pos, &ed);
     int depth_index = depth_to_index(depth);
     if (nullmove_enabled &&
             depth > PLY &&
@@ -743,20 +1123,21 @@ static int search(position_t* pos,
         // Nullmove search.
         undo_info_t undo;
         do_nullmove(pos, &undo);
+        prefetch_transposition(data->trans_table, pos->hash);
         float null_r = 2.0 + ((depth + 2.0)/4.0) +
             CLAMP(0, 1.5, (lazy_score-beta)/100.0);
-        int null_score = -search(pos, search_node+1, ply+1,
+        int null_score = -search_nonpv(data, pos, search_node+1, ply+1,
                 -beta, -beta+1, depth - null_r);
         undo_nullmove(pos, &undo);
         if (is_mate_score(null_score) && null_score < 0) mate_threat = true;
         if (null_score >= beta) {
             if (verification_enabled) {
                 float rdepth = depth - null_verification_reduction;
-                if (rdepth > 0) null_score = search(pos,
+                if (rdepth > 0) null_score = search_nonpv(data, pos,
                         search_node, ply, alpha, beta, rdepth);
             }
-            root_data.stats.nullmove_cutoffs[
-                depth_to_index(root_data.current_depth)]++;
+            data->stats.nullmove_cutoffs[
+                depth_to_index(data->current_depth)]++;
             if (null_score >= beta) return beta;
         }
     } else if (razoring_enabled &&
@@ -767,9 +1148,11 @@ static int search(position_t* pos,
             !is_mate_score(beta) &&
             lazy_score + razor_margin[depth_index] < beta) {
         // Razoring.
-        if (depth <= PLY) return quiesce(pos, search_node, ply, alpha, beta, 0);
+        if (depth <= PLY) {
+            return quiesce(data, pos, search_node, ply, alpha, beta, 0);
+        }
         int qbeta = beta - razor_qmargin[depth_index];
-        int qscore = quiesce(pos, search_node, ply, qbeta-1, qbeta, 0);
+        int qscore = quiesce(data, pos, search_node, ply, qbeta-1, qbeta, 0);
         if (qscore < qbeta) return qscore;
     }
 
@@ -780,71 +1163,56 @@ static int search(position_t* pos,
                 depth - iid_pv_depth_reduction :
                 MIN(depth/2, depth - iid_non_pv_depth_reduction);
         assert(iid_depth > 0);
-        search(pos, search_node, ply, alpha, beta, iid_depth);
+        if (full_window) {
+            search_pv(data, pos, search_node, ply, alpha, beta, iid_depth);
+        } else {
+            search_nonpv(data, pos, search_node, ply, alpha, beta, iid_depth);
+        }
         hash_move = search_node->pv[ply];
         search_node->pv[ply] = NO_MOVE;
     }
 
     move_t searched_moves[256];
     move_selector_t selector;
-    init_move_selector(&selector, pos, full_window ? PV_GEN : NONPV_GEN,
+    init_move_selector(&selector, data, pos,
+            full_window ? PV_GEN : NONPV_GEN,
             search_node, hash_move, depth, ply);
     bool single_reply = has_single_reply(&selector);
     int num_legal_moves = 0, num_futile_moves = 0, num_searched_moves = 0;
+    bool did_split = false;
+    const hashkey_t hash = pos->hash;
+    const bool abdada = options.parallel_algorithm == PARALLEL_ABDADA &&
+        options.num_threads > 1 &&
+        depth >= abdada_min_depth;
     for (move_t move = select_move(&selector); move != NO_MOVE;
             move = select_move(&selector)) {
         num_legal_moves = selector.moves_so_far;
-        int64_t nodes_before = root_data.nodes_searched;
+
+        // ABDADA: once the first move is searched, put off any move that
+        // another thread is already searching. We'll come back to it after
+        // everything else has been searched.
+        if (abdada && num_legal_moves > 1 &&
+                is_move_being_searched(hash, move) &&
+                defer_move(&selector, move)) continue;
+        int64_t nodes_before = data->nodes_searched;
 
         undo_info_t undo;
-        do_move(pos, move, &undo);
+        do_search_move(data, pos, move, &undo);
         float ext = extend(pos, move, single_reply, full_window);
-        if (ext && defer_move(&selector, move)) {
-            undo_move(pos, move, &undo);
-            continue;
-        }
         if (num_legal_moves == 1) {
             // First move, use full window search.
-            score = -search(pos, search_node+1, ply+1,
+            if (full_window) score = -search(data, pos, search_node+1, ply+1,
+                    -beta, -alpha, depth+ext-PLY);
+            else score = -search_nonpv(data, pos, search_node+1, ply+1,
                     -beta, -alpha, depth+ext-PLY);
         } else {
-            // Futility pruning. Note: it would be nice to do extensions and
-            // futility before calling do_move, but this would require more
-            // efficient ways of identifying important moves without actually
-            // making them.
-            const bool prune_futile = futility_enabled &&
-                !full_window &&
-                !ext &&
-                !mate_threat &&
-                depth <= futility_depth_limit &&
-                !is_check(pos) &&
-                num_legal_moves >= depth_index + 2 &&
-                should_try_prune(&selector, move);
-            if (prune_futile) {
-                // History pruning.
-                // TODO: try more stringent depth requirements
-                // TODO: try pruning based on pure move ordering, or work
-                // move order into the history count
-                // TODO: experiment with pruning inside pv
-                if (history_prune_enabled && depth <= 3.0 &&
-                        is_history_prune_allowed(&root_data.history,
-                            move, depth)) {
-                    num_futile_moves++;
-                    undo_move(pos, move, &undo);
-                    if (full_window) add_pv_move(&selector, move, 0);
-                    continue;
-                }
-                // Value pruning.
-                if (value_prune_enabled &&
-                        lazy_score +
-                        material_value(get_move_capture(move)) +
-                        85 + 15*depth + 2*depth*depth <
-                        beta + 2*num_legal_moves) {
-                    num_futile_moves++;
-                    undo_move(pos, move, &undo);
-                    if (full_window) add_pv_move(&selector, move, 0);
-                    continue;
-                }
+            if (is_move_futile(data, pos, &selector, move, ext, mate_threat,
+                        full_window, depth, lazy_score, beta,
+                        num_legal_moves)) {
+                num_futile_moves++;
+                undo_move(pos, move, &undo);
+                if (full_window) add_pv_move(&selector, move, 0);
+                continue;
             }
             // Late move reduction (LMR), as described by Tord Romstad at
             // http://www.glaurungchess.com/lmr.html
@@ -854,49 +1222,36 @@ static int search(position_t* pos,
                 depth > lmr_depth_limit;
             float lmr_red = 0;
             if (try_lmr) lmr_red = lmr_reduction(&selector, move, full_window);
-            if (lmr_red) score = -search(pos, search_node+1, ply+1,
-                    -alpha-1, -alpha, depth-lmr_red-PLY);
+            if (abdada) start_searching_move(hash, move);
+            if (lmr_red) score = -search_nonpv(data, pos, search_node+1,
+                    ply+1, -alpha-1, -alpha, depth-lmr_red-PLY);
             else score = alpha+1;
             if (score > alpha) {
-                score = -search(pos, search_node+1, ply+1,
+                score = -search_nonpv(data, pos, search_node+1, ply+1,
                         -alpha-1, -alpha, depth+ext-PLY);
-                if (score > alpha) score = -search(pos, search_node+1, ply+1,
-                        -beta, -alpha, depth+ext-PLY);
+                if (score > alpha) score = -search(data, pos,
+                        search_node+1, ply+1, -beta, -alpha, depth+ext-PLY);
             }
+            if (abdada) finish_searching_move(hash, move);
         }
         searched_moves[num_searched_moves++] = move;
         undo_move(pos, move, &undo);
         if (full_window) add_pv_move(&selector, move,
-                root_data.nodes_searched - nodes_before);
+                data->nodes_searched - nodes_before);
         if (score > alpha) {
             alpha = score;
             update_pv(search_node->pv, (search_node+1)->pv, ply, move);
             check_line(pos, search_node->pv+ply);
             if (score >= beta) {
-                if (!get_move_capture(move) &&
-                        !get_move_promote(move)) {
-                    record_success(&root_data.history, move, depth);
-                    for (int i=0; i<num_searched_moves-1; ++i) {
-                        move_t m = searched_moves[i];
-                        assert(m != move);
-                        if (!get_move_capture(m) && !get_move_promote(m)) {
-                            record_failure(&root_data.history, m, depth);
-                        }
-                    }
-                    if (move != search_node->killers[0]) {
-                        search_node->killers[1] = search_node->killers[0];
-                        search_node->killers[0] = move;
-                    }
-                }
-                if (is_mate_score(score) && score > 0) {
-                    search_node->mate_killer = move;
-                }
-                put_transposition(pos, move, depth, beta,
+                record_cutoff(data, search_node, move, score, depth,
+                        searched_moves, num_searched_moves);
+                put_transposition(data->trans_table, pos, move, depth, beta,
                         SCORE_LOWERBOUND, mate_threat);
-                root_data.stats.move_selection[
+                data->stats.move_selection[
                     MIN(num_legal_moves-1, HIST_BUCKETS)]++;
+                data->stats.phase_cutoffs[*selector.phase]++;
                 if (full_window) {
-                    root_data.stats.pv_move_selection[
+                    data->stats.pv_move_selection[
                         MIN(num_legal_moves-1, HIST_BUCKETS)]++;
                     while ((move = select_move(&selector))) {
                         add_pv_move(&selector, move, 0);
@@ -907,8 +1262,52 @@ static int search(position_t* pos,
                 return beta;
             }
         }
+
+        // Young brothers wait: once the first move has been searched, let
+        // any idle helpers share the remaining moves at this node.
+        if (should_split(data, depth)) {
+            split_point_t sp;
+            sp.master = data;
+            sp.selector = &selector;
+            copy_position(&sp.pos, pos);
+            sp.ply = ply;
+            sp.depth = depth;
+            sp.alpha = alpha;
+            sp.beta = beta;
+            sp.lazy_score = lazy_score;
+            sp.full_window = full_window;
+            sp.mate_threat = mate_threat;
+            sp.single_reply = single_reply;
+            sp.searched_moves = searched_moves;
+            sp.num_searched_moves = num_searched_moves;
+            split(data, &sp);
+
+            did_split = true;
+            num_legal_moves = selector.moves_so_far;
+            num_searched_moves = sp.num_searched_moves;
+            if (is_search_aborted(data)) return 0;
+            if (sp.best_move != NO_MOVE) {
+                alpha = sp.alpha;
+                update_pv(search_node->pv, sp.pv, ply, sp.best_move);
+                check_line(pos, search_node->pv+ply);
+            }
+            if (alpha >= beta) {
+                record_cutoff(data, search_node, sp.best_move, alpha, depth,
+                        searched_moves, num_searched_moves);
+                put_transposition(data->trans_table, pos, sp.best_move,
+                        depth, beta, SCORE_LOWERBOUND, mate_threat);
+                data->stats.move_selection[
+                    MIN(num_legal_moves-1, HIST_BUCKETS)]++;
+                data->stats.phase_cutoffs[*selector.phase]++;
+                if (full_window) data->stats.pv_move_selection[
+                    MIN(num_legal_moves-1, HIST_BUCKETS)]++;
+                search_node->pv[ply] = NO_MOVE;
+                return beta;
+            }
+            break;
+        }
     }
-    if (full_window) commit_pv_moves(&selector);
+    if (full_window && !did_split) commit_pv_moves(&selector);
     if (!num_legal_moves) {
         // No legal moves, this is either stalemate or checkmate.
         search_node->pv[ply] = NO_MOVE;
@@ -916,64 +1315,120 @@ static int search(position_t* pos,
         return DRAW_VALUE;
     }
 
-    root_data.stats.move_selection[MIN(num_legal_moves-1, HIST_BUCKETS)]++;
-    if (full_window) root_data.stats.pv_move_selection[
+    data->stats.move_selection[MIN(num_legal_moves-1, HIST_BUCKETS)]++;
+    if (full_window) data->stats.pv_move_selection[
         MIN(num_legal_moves-1, HIST_BUCKETS)]++;
     if (alpha == orig_alpha) {
-        put_transposition(pos, NO_MOVE, depth, alpha,
+        put_transposition(data->trans_table, pos, NO_MOVE, depth, alpha,
                 SCORE_UPPERBOUND, mate_threat);
     } else {
-        put_transposition(pos, search_node->pv[ply], depth, alpha,
-                SCORE_EXACT, mate_threat);
+        put_transposition(data->trans_table, pos, search_node->pv[ply],
+                depth, alpha, SCORE_EXACT, mate_threat);
     }
     return alpha;
 }
 
+static int search_pv(search_data_t* data,
+        position_t* pos,
+        search_node_t* search_node,
+        int ply,
+        int alpha,
+        int beta,
+        float depth)
+{
+    return search_body(data, pos, search_node, ply, alpha, beta, depth, true);
+}
+
+static int search_nonpv(search_data_t* data,
+        position_t* pos,
+        search_node_t* search_node,
+        int ply,
+        int alpha,
+        int beta,
+        float depth)
+{
+    return search_body(data, pos, search_node, ply, alpha, beta, depth, false);
+}
+
 /*
- * Search a position until it becomes "quiet". This is called at the leaves
- * of |search| to avoid using the static evaluator on positions that have
- * easy tactics on the board.
+ * Search a node with the copy of |search_body| for its node type. The type
+ * is decided by the window after it's clamped to the mate scores, just as it
+ * would be inside the search.
  */
-static int quiesce(position_t* pos,
+static int search(search_data_t* data,
+        position_t* pos,
         search_node_t* search_node,
         int ply,
         int alpha,
         int beta,
         float depth)
 {
-    if (root_data.engine_status == ENGINE_ABORTED) return 0;
-    if (root_data.current_root_move &&
-            ply > root_data.current_root_move->max_ply) {
-        root_data.current_root_move->max_ply = ply;
+    if (MIN(beta, mate_in(ply)) - MAX(alpha, mated_in(ply)) > 1) {
+        return search_pv(data, pos, search_node, ply, alpha, beta, depth);
     }
+    return search_nonpv(data, pos, search_node, ply, alpha, beta, depth);
+}
+
+/*
+ * Search a position until it becomes "quiet". This is called at the leaves
+ * of |search| to avoid using the static evaluator on positions that have
+ * easy tactics on the board. Like |search_body|, this is only called with
+ * constant |full_window| and |in_check|.
+ */
+static FORCE_INLINE int quiesce_body(search_data_t* data,
+        position_t* pos,
+        search_node_t* search_node,
+        int ply,
+        int alpha,
+        int beta,
+        float depth,
+        const bool full_window,
+        const bool in_check)
+{
     search_node->pv[ply] = NO_MOVE;
-    open_qnode(&root_data, ply);
+    if (is_search_aborted(data)) return 0;
+    if (data->current_root_move &&
+            ply > data->current_root_move->max_ply) {
+        data->current_root_move->max_ply = ply;
+    }
+    open_qnode(data, ply);
 
     alpha = MAX(alpha, mated_in(ply));
     beta = MIN(beta, mate_in(ply));
     if (alpha >= beta) return alpha;
     if (is_draw(pos)) return DRAW_VALUE;
-    bool full_window = (beta-alpha > 1);
+    assert(full_window == (beta-alpha > 1));
+    assert(in_check == is_check(pos));
 
     // Get move from transposition table if possible.
     int orig_alpha = alpha;
-    transposition_entry_t* trans_entry = get_transposition(pos);
+    transposition_entry_t trans_entry_copy;
+    transposition_entry_t* trans_entry =
+        get_transposition(data->trans_table, pos, &trans_entry_copy);
     move_t hash_move = trans_entry ? trans_entry->move : NO_MOVE;
     if (trans_entry && 
             is_trans_cutoff_allowed(trans_entry, depth, &alpha, &beta)) {
         search_node->pv[ply] = hash_move;
         search_node->pv[ply+1] = NO_MOVE;
-        root_data.stats.transposition_cutoffs[
-            depth_to_index(root_data.current_depth)]++;
+        data->stats.transposition_cutoffs[
+            depth_to_index(data->current_depth)]++;
         return MAX(alpha, trans_entry->score);
     }
 
     eval_data_t ed;
+    init_eval_data(&ed, data->pawn_table,
+            data->material_table, data->eval_table);
     if (ply >= MAX_SEARCH_PLY-1) return full_eval(pos, &ed);
     int eval = alpha;
-    if (!is_check(pos)) {
-        eval = full_eval(pos, &ed);
-        check_eval_symmetry(pos, eval);
+    if (!in_check) {
+        // Outside the lazy window the eval is only an estimate. The window
+        // reaches far enough below alpha that the estimate still decides
+        // whether checks are generated the same way the exact eval would.
+        int lazy_alpha = alpha - qcheck_margin - 1;
+        eval = lazy_eval(pos, &ed, lazy_alpha, beta);
+        if (eval > lazy_alpha && eval < beta) {
+            check_eval_symmetry(pos, &ed, eval);
+        }
         if (trans_entry && ((eval > trans_entry->score &&
                     trans_entry->flags & SCORE_UPPERBOUND) ||
                 (eval < trans_entry->score &&
@@ -986,13 +1441,13 @@ static int quiesce(position_t* pos,
 
     bool allow_futility = qfutility_enabled &&
         !full_window &&
-        !is_check(pos) &&
+        !in_check &&
         pos->num_pieces[pos->side_to_move] > 2;
     int num_qmoves = 0;
     move_selector_t selector;
-    generation_t gen_type = depth >= -0.5 && eval + 150 >= alpha ?
+    generation_t gen_type = depth >= -0.5 && eval + qcheck_margin >= alpha ?
         Q_CHECK_GEN : Q_GEN;
-    init_move_selector(&selector, pos, gen_type,
+    init_move_selector(&selector, data, pos, gen_type,
             search_node, hash_move, depth, ply);
     for (move_t move = select_move(&selector); move != NO_MOVE;
             move = select_move(&selector), ++num_qmoves) {
@@ -1005,30 +1460,108 @@ static int quiesce(position_t* pos,
                 qfutility_margin < alpha) continue;
         if (move != hash_move && static_exchange_sign(pos, move) < 0) continue;
         undo_info_t undo;
-        do_move(pos, move, &undo);
-        int score = -quiesce(pos, search_node+1, ply+1, -beta, -alpha, depth-PLY);
+        do_search_move(data, pos, move, &undo);
+        int score = -quiesce(data, pos, search_node+1, ply+1,
+                -beta, -alpha, depth-PLY);
         undo_move(pos, move, &undo);
         if (score > alpha) {
             alpha = score;
             update_pv(search_node->pv, (search_node+1)->pv, ply, move);
             check_line(pos, search_node->pv+ply);
             if (score >= beta) {
-                put_transposition(pos, move, depth, beta,
+                data->stats.phase_cutoffs[*selector.phase]++;
+                put_transposition(data->trans_table, pos, move, depth, beta,
                         SCORE_LOWERBOUND, false);
                 return beta;
             }
         }
     }
-    if (!num_qmoves && is_check(pos)) {
+    if (!num_qmoves && in_check) {
         return mated_in(ply);
     }
     if (alpha == orig_alpha) {
-        put_transposition(pos, NO_MOVE, depth, alpha,
+        put_transposition(data->trans_table, pos, NO_MOVE, depth, alpha,
                 SCORE_UPPERBOUND, false);
     } else {
-        put_transposition(pos, search_node->pv[ply], depth, alpha,
-                SCORE_EXACT, false);
+        put_transposition(data->trans_table, pos, search_node->pv[ply],
+                depth, alpha, SCORE_EXACT, false);
     }
     return alpha;
 }
 
+static int quiesce_pv(search_data_t* data,
+        position_t* pos,
+        search_node_t* search_node,
+        int ply,
+        int alpha,
+        int beta,
+        float depth)
+{
+    return quiesce_body(data, pos, search_node, ply, alpha, beta, depth,
+            true, false);
+}
+
+static int quiesce_nonpv(search_data_t* data,
+        position_t* pos,
+        search_node_t* search_node,
+        int ply,
+        int alpha,
+        int beta,
+        float depth)
+{
+    return quiesce_body(data, pos, search_node, ply, alpha, beta, depth,
+            false, false);
+}
+
+static int quiesce_pv_evasions(search_data_t* data,
+        position_t* pos,
+        search_node_t* search_node,
+        int ply,
+        int alpha,
+        int beta,
+        float depth)
+{
+    return quiesce_body(data, pos, search_node, ply, alpha, beta, depth,
+            true, true);
+}
+
+static int quiesce_nonpv_evasions(search_data_t* data,
+        position_t* pos,
+        search_node_t* search_node,
+        int ply,
+        int alpha,
+        int beta,
+        float depth)
+{
+    return quiesce_body(data, pos, search_node, ply, alpha, beta, depth,
+            false, true);
+}
+
+/*
+ * Search a quiescent node with the copy of |quiesce_body| for its node type
+ * and check status.
+ */
+static int quiesce(search_data_t* data,
+        position_t* pos,
+        search_node_t* search_node,
+        int ply,
+        int alpha,
+        int beta,
+        float depth)
+{
+    const bool full_window =
+        MIN(beta, mate_in(ply)) - MAX(alpha, mated_in(ply)) > 1;
+    if (is_check(pos)) {
+        if (full_window) {
+            return quiesce_pv_evasions(data, pos, search_node, ply,
+                    alpha, beta, depth);
+        }
+        return quiesce_nonpv_evasions(data, pos, search_node, ply,
+                alpha, beta, depth);
+    }
+    if (full_window) {
+        return quiesce_pv(data, pos, search_node, ply, alpha, beta, depth);
+    }
+    return quiesce_nonpv(data, pos, search_node, ply, alpha, beta, depth);
+}
+
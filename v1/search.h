@@ -30,6 +30,10 @@ typedef int score_type_t;
 #define SCORE_MASK          0x03
 #define MATE_THREAT         0x04
 
+typedef enum {
+    PARALLEL_LAZY_SMP, PARALLEL_YBW, PARALLEL_ABDADA
+} parallel_algorithm_t;
+
 typedef move_t(*book_fn)(position_t*);
 typedef struct {
     int multi_pv;
@@ -39,8 +43,6 @@ typedef struct {
     book_fn probe_book;
     bool use_scorpio_bb;
     bool use_gtb;
-    bool use_gtb_dtm;
-    bool root_in_gtb;
     bool nonblocking_gtb;
     int gtb_cache_size;
     int gtb_scheme;
@@ -48,18 +50,28 @@ typedef struct {
     int verbosity;
     bool chess960;
     bool arena_castle;
+    bool bitboard_movegen;
+    bool pin_aware_see;
     bool ponder;
+    int num_threads;
+    parallel_algorithm_t parallel_algorithm;
+    bool large_pages;
+    bool lock_hash;
+    int tt_replacement;
 } options_t;
 
 extern options_t options;
 
 #define HIST_BUCKETS    15
+#define MAX_SELECTION_PHASES    16
 
 typedef struct {
     int transposition_cutoffs[MAX_SEARCH_PLY + 1];
     int nullmove_cutoffs[MAX_SEARCH_PLY + 1];
     int move_selection[HIST_BUCKETS + 1];
     int pv_move_selection[HIST_BUCKETS + 1];
+    int phase_starts[MAX_SELECTION_PHASES];    // by selection_phase_t
+    int phase_cutoffs[MAX_SELECTION_PHASES];
     int razor_attempts[3];
     int razor_prunes[3];
     int root_fail_highs;
@@ -108,7 +120,28 @@ typedef struct {
     int current_move_index;
     bool resolving_fail_high;
     move_t obvious_move;
-    engine_status_t engine_status;
+    int best_move_time; // when the current best root move was first found
+    volatile engine_status_t engine_status;
+    int thread_id;
+    bool root_in_gtb;
+    bool use_gtb_dtm;
+
+    // hash tables; these default to the engine's global tables, but can be
+    // pointed elsewhere to run searches independently of one another
+    transposition_table_t* trans_table;
+    pawn_table_t* pawn_table;
+    material_table_t* material_table;
+    eval_table_t* eval_table;
+    struct pv_cache_t* pv_cache;
+
+    // silent searches don't poll for input, print output, or start helpers
+    bool silent;
+    int last_info_time;
+
+    // split point search state
+    struct split_point_t* split_point;
+    struct split_point_t* volatile assigned_split;
+    volatile bool idle;
 
     // when should we stop?
     milli_timer_t timer;
@@ -123,6 +156,37 @@ typedef struct {
 
 extern search_data_t root_data;
 
+#define MAX_SEARCH_THREADS  64
+
+/*
+ * A node whose remaining moves are searched in parallel by its owner and
+ * any idle helpers (young brothers wait). The selector is shared by all
+ * threads at the split point, and is protected by |lock| along with the
+ * search results. A cutoff by any thread cancels the whole split point.
+ */
+typedef struct split_point_t {
+    struct split_point_t* parent;
+    search_data_t* master;
+    struct move_selector_t* selector;
+    position_t pos;
+    int ply;
+    float depth;
+    int beta;
+    int lazy_score;
+    bool full_window;
+    bool mate_threat;
+    bool single_reply;
+
+    mutex_t lock;
+    volatile int num_workers;
+    volatile bool cancelled;
+    volatile int alpha;
+    move_t best_move;
+    move_t* searched_moves;
+    int num_searched_moves;
+    move_t pv[MAX_SEARCH_PLY + 1];
+} split_point_t;
+
 #define POLL_INTERVAL   0x3fff
 #define MATE_VALUE      32000
 #define DRAW_VALUE      0
@@ -134,7 +198,8 @@ extern search_data_t root_data;
 #define mate_in(ply)                (MATE_VALUE-(ply))
 #define mated_in(ply)               (-MATE_VALUE+(ply))
 #define should_output(s)    \
-    (elapsed_time(&((s)->timer)) > options.output_delay)
+    ((s)->thread_id == 0 && !(s)->silent && \
+     elapsed_time(&((s)->timer)) > options.output_delay)
 
 
 #ifdef __cplusplus
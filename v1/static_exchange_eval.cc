@@ -1,133 +1,119 @@
-
 #include "daydreamer.h"
 
 /*
- * Count all attackers and defenders of a square to determine whether or not
- * a capture is advantageous. Captures with a positive static eval are
- * favorable. Note: this implementation does not account for pinned pieces.
+ * Find the pieces that can't join an exchange on the square with index |to|
+ * because they're pinned to their king along a line that doesn't pass
+ * through |to|. Pins are only found once, at the start of the exchange, so a
+ * piece stays pinned even if its pinner is exchanged off.
  */
-int static_exchange_eval(const position_t* pos, move_t move)
+static bitboard_t pinned_attackers(const position_t* pos, int to)
 {
-    square_t attacker_sq = get_move_from(move);
-    square_t attacked_sq = get_move_to(move);
-    piece_t attacker = get_move_piece(move);
-    piece_t captured = get_move_capture(move);
-    square_t attacker_sqs[2][16];
-    int num_attackers[2] = { 0, 0 };
-    int initial_attacker[2] = { 0, 0 };
-    int index;
-
-    // Find all the pieces that could be attacking.
-    // Pawns are handled separately, because there are potentially a lot of
-    // them and only a few squares they could attack from.
-    if (pos->board[attacked_sq + NW] == BP && attacked_sq + NW != attacker_sq) {
-        index = num_attackers[BLACK]++;
-        attacker_sqs[BLACK][index] = attacked_sq + NW;
-    }
-    if (pos->board[attacked_sq + NE] == BP && attacked_sq + NE != attacker_sq) {
-        index = num_attackers[BLACK]++;
-        attacker_sqs[BLACK][index] = attacked_sq + NE;
-    }
-    if (pos->board[attacked_sq + SW] == WP && attacked_sq + SW != attacker_sq) {
-        index = num_attackers[WHITE]++;
-        attacker_sqs[WHITE][index] = attacked_sq + SW;
-    }
-    if (pos->board[attacked_sq + SE] == WP && attacked_sq + SE != attacker_sq) {
-        index = num_attackers[WHITE]++;
-        attacker_sqs[WHITE][index] = attacked_sq + SE;
-    }
-    
+    bitboard_t pinned = EMPTY_BB;
     for (color_t side=WHITE; side<=BLACK; ++side) {
-        square_t from, att_sq;
-        piece_t piece;
-        square_t att_dir;
-        for (int i=0; pos->pieces[side][i] != INVALID_SQUARE; ++i) {
-            from = pos->pieces[side][i];
-            piece = pos->board[from];
-            if (from == attacker_sq) continue;
-            if (!possible_attack(from, attacked_sq, piece)) continue;
-            piece_type_t type = piece_type(piece);
-            switch (type) {
-                case KING:
-                case KNIGHT:
-                    attacker_sqs[side][num_attackers[side]++] = from;
-                    break;
-                case BISHOP:
-                case ROOK:
-                case QUEEN:
-                    att_dir = (square_t)direction(from, attacked_sq);
-                    for (att_sq = from + att_dir; att_sq != attacked_sq &&
-                            pos->board[att_sq] == EMPTY; att_sq += att_dir) {}
-                    if (att_sq == attacked_sq) {
-                        attacker_sqs[side][num_attackers[side]++] = from;
-                    }
-                    break;
-                default: assert(false);
-            }
+        int king_ind = square_to_index(pos->pieces[side][0]);
+        bitboard_t blockers = king_blockers(pos, side, side);
+        for (; blockers; blockers &= blockers - 1) {
+            int ind = first_bit(blockers);
+            if (!bit_is_set(line_mask[king_ind][ind], to)) set_bit(pinned, ind);
         }
     }
+    return pinned;
+}
 
-    // At this point, all unblocked attackers other than |attacker| have been
-    // added to |attackers|. Now play out all possible captures in order of
-    // increasing piece value (but starting with |attacker|) while alternating
-    // colors. Whenever a capture is made, add any x-ray attackers that removal
-    // of the piece would reveal.
-    color_t side = piece_color(attacker);
-    initial_attacker[side] = 1;
-    int gain[32] = { material_value(captured) };
-    int gain_index = 1;
-    int capture_value = material_value(attacker);
-    bool initial_attack = true;
-    while (num_attackers[side] + initial_attacker[side] + 1 || initial_attack) {
-        initial_attack = false;
-        // add in any new x-ray attacks
-        const attack_data_t* att_data =
-            &get_attack_data(attacker_sq, attacked_sq);
-        if (att_data->possible_attackers & Q_FLAG) {
-            square_t sq;
-            for (sq=attacker_sq - att_data->relative_direction;
-                    pos->board[sq] == EMPTY;
-                    sq -= att_data->relative_direction) {}
-            if (pos->board[sq] != OUT_OF_BOUNDS) {
-                const piece_t xray_piece = pos->board[sq];
-                if (att_data->possible_attackers & 
-                        get_piece_flag(xray_piece)) {
-                    const color_t xray_color = piece_color(xray_piece);
-                    index = num_attackers[xray_color]++;
-                    attacker_sqs[xray_color][index] = sq;
-                }
-            }
-        }
+/*
+ * Find the least valuable of |side|'s pieces in |attackers|. Its type is
+ * returned, and its square is stored in |ind|.
+ */
+static piece_type_t least_valuable_attacker(const position_t* pos,
+        bitboard_t attackers,
+        color_t side,
+        int* ind)
+{
+    const bitboard_t* bb = &pos->piece_bb[create_piece(side, NONE)];
+    piece_type_t type = PAWN;
+    for (; type<KING && !(attackers & bb[type]); ++type) {}
+    *ind = first_bit(attackers & bb[type]);
+    return type;
+}
+
+/*
+ * Remove the piece on |ind| from |*occupied| after it captures on |to|, and
+ * return |attackers| with any sliders that were behind it added.
+ */
+static bitboard_t remove_attacker(const position_t* pos,
+        bitboard_t attackers,
+        piece_type_t type,
+        int ind,
+        int to,
+        bitboard_t* occupied)
+{
+    *occupied ^= set_mask[ind];
+    if (type == PAWN || type == BISHOP || type == QUEEN) {
+        attackers |= bishop_attacks(to, *occupied) &
+            (pos->piece_bb[WB] | pos->piece_bb[BB] |
+             pos->piece_bb[WQ] | pos->piece_bb[BQ]);
+    }
+    if (type == ROOK || type == QUEEN) {
+        attackers |= rook_attacks(to, *occupied) &
+            (pos->piece_bb[WR] | pos->piece_bb[BR] |
+             pos->piece_bb[WQ] | pos->piece_bb[BQ]);
+    }
+    return attackers & *occupied;
+}
+
+/*
+ * Find the squares occupied after |move|'s piece leaves its square, and the
+ * pieces of both sides that could then join the exchange on its target.
+ */
+static bitboard_t initial_attackers(const position_t* pos,
+        move_t move,
+        bitboard_t* occupied)
+{
+    int to = square_to_index(get_move_to(move));
+    *occupied = occupied_squares(pos) ^
+        set_mask[square_to_index(get_move_from(move))];
+    if (is_move_enpassant(move)) {
+        color_t side = piece_color(get_move_piece(move));
+        clear_sq_bit(*occupied, get_move_to(move) - pawn_push[side]);
+    }
+    bitboard_t attackers = attackers_to(pos, to, *occupied) & *occupied;
+    if (options.pin_aware_see) attackers &= ~pinned_attackers(pos, to);
+    return attackers;
+}
 
-        // score the capture under the assumption that it's defended.
-        gain[gain_index] = capture_value - gain[gain_index - 1];
+/*
+ * Count all attackers and defenders of a square to determine whether or not
+ * a capture is advantageous. Captures with a positive static eval are
+ * favorable. Captures are played out from the least valuable attacker up,
+ * and sliders join in as the pieces in front of them are exchanged off. With
+ * the "Pin-aware SEE" option, pieces pinned to their king are left out.
+ */
+int static_exchange_eval(const position_t* pos, move_t move)
+{
+    int to = square_to_index(get_move_to(move));
+    color_t side = piece_color(get_move_piece(move));
+    bitboard_t occupied;
+    bitboard_t attackers = initial_attackers(pos, move, &occupied);
+    int gain[32] = { material_value(get_move_capture(move)) };
+    int gain_index = 0;
+    int capture_value = material_value(get_move_piece(move));
+    while (true) {
+        // Score the last capture under the assumption that it's defended.
         ++gain_index;
+        gain[gain_index] = capture_value - gain[gain_index-1];
         side = flip_color(side);
-
-        // find the next lowest valued attacker
-        int least_value = material_value(KING)+1;
-        int att_index = -1;
-        for (int i=0; i<num_attackers[side]; ++i) {
-            capture_value = material_value(pos->board[attacker_sqs[side][i]]);
-            if (capture_value < least_value) {
-                least_value = capture_value;
-                att_index = i;
-            }
-        }
-        if (att_index == -1) {
-            assert(num_attackers[side] == 0);
-            break;
-        }
-        attacker = pos->board[attacker_sqs[side][att_index]];
-        attacker_sq = attacker_sqs[side][att_index];
-        index = --num_attackers[side];
-        attacker_sqs[side][att_index] = attacker_sqs[side][index];
-        capture_value = least_value;
-        if (piece_type(attacker) == KING && num_attackers[side^1]) break;
+        bitboard_t side_attackers = attackers & pos->color_bb[side];
+        if (!side_attackers) break;
+        int ind;
+        piece_type_t type = least_valuable_attacker(pos,
+                side_attackers, side, &ind);
+        // The king can only capture if nothing can recapture.
+        if (type == KING && (attackers & pos->color_bb[side^1])) break;
+        capture_value = material_value(type);
+        attackers = remove_attacker(pos, attackers, type, ind, to, &occupied);
     }
 
     // Now that gain array is set up, scan back through to get score.
-    --gain_index;
     while (--gain_index) {
         gain[gain_index-1] = -gain[gain_index-1] < gain[gain_index] ?
             -gain[gain_index] : gain[gain_index-1];
@@ -135,6 +121,44 @@ int static_exchange_eval(const position_t* pos, move_t move)
     return gain[0];
 }
 
+/*
+ * Is the static exchange eval of |move| at least |threshold|? This plays out
+ * the same exchange as |static_exchange_eval|, but stops as soon as the side
+ * to capture next can't change the answer.
+ */
+bool see_ge(const position_t* pos, move_t move, int threshold)
+{
+    // |swap| is how much the side that's about to capture needs to win
+    // back for the exchange to go its way, assuming that the piece that
+    // just captured is lost.
+    int swap = material_value(get_move_capture(move)) - threshold;
+    if (swap < 0) return false;
+    swap = material_value(get_move_piece(move)) - swap;
+    if (swap <= 0) return true;
+
+    int to = square_to_index(get_move_to(move));
+    color_t side = piece_color(get_move_piece(move));
+    bitboard_t occupied;
+    bitboard_t attackers = initial_attackers(pos, move, &occupied);
+    int result = 1;
+    while (true) {
+        side = flip_color(side);
+        bitboard_t side_attackers = attackers & pos->color_bb[side];
+        if (!side_attackers) break;
+        result ^= 1;
+        int ind;
+        piece_type_t type = least_valuable_attacker(pos,
+                side_attackers, side, &ind);
+        if (type == KING) {
+            return (attackers & pos->color_bb[side^1]) ? !result : result;
+        }
+        swap = material_value(type) - swap;
+        if (swap < result) break;
+        attackers = remove_attacker(pos, attackers, type, ind, to, &occupied);
+    }
+    return result;
+}
+
 /*
  * If we only care about whether or not a move is losing, sometimes we don't
  * need a full static exchange eval and can bail out early.
@@ -144,5 +168,5 @@ int static_exchange_sign(const position_t* pos, move_t move)
     piece_type_t attacker_type = piece_type(get_move_piece(move));
     piece_type_t captured_type = piece_type(get_move_capture(move));
     if (attacker_type == KING || attacker_type <= captured_type) return 1;
-    return static_exchange_eval(pos, move);
+    return see_ge(pos, move, 0) ? 1 : -1;
 }
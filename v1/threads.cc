@@ -0,0 +1,226 @@
+
+#include "daydreamer.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Helper threads for parallel search. With lazy smp and ABDADA, each helper
+ * runs its own iterative deepening search of the root position with a
+ * private copy of the search data, communicating with the main thread only
+ * through the shared transposition table (and, for ABDADA, the table of
+ * moves currently being searched). With young brothers wait, helpers sit
+ * idle until a searching thread assigns them to one of its split points.
+ */
+static search_data_t* helper_data[MAX_SEARCH_THREADS];
+static pawn_table_t helper_pawn_tables[MAX_SEARCH_THREADS];
+static material_table_t helper_material_tables[MAX_SEARCH_THREADS];
+static eval_table_t helper_eval_tables[MAX_SEARCH_THREADS];
+static thread_t helper_threads[MAX_SEARCH_THREADS];
+static int num_helpers = 0;
+static bool helpers_running = false;
+static mutex_t split_lock;
+static bool split_lock_initialized = false;
+static const int max_split_helpers = 7;
+
+// ABDADA marks each move that's being searched by storing a key derived from
+// the position and move in this table. It's small and lossy: a collision
+// just means a move gets searched by two threads at once, or deferred when
+// it didn't need to be.
+#define SEARCHING_TABLE_SIZE    (1<<15)
+static volatile hashkey_t searching_table[SEARCHING_TABLE_SIZE];
+#define searching_key(hash, move) \
+    ((hash) ^ ((hashkey_t)(move) * 0x9e3779b97f4a7c15ull))
+#define searching_index(key)    ((key) & (SEARCHING_TABLE_SIZE-1))
+
+/*
+ * Wait for split point assignments, and search them until the main
+ * thread stops us.
+ */
+static void split_point_idle_loop(search_data_t* data)
+{
+    data->idle = true;
+    while (data->engine_status != ENGINE_ABORTED) {
+        split_point_t* sp = data->assigned_split;
+        if (!sp) {
+            yield_thread();
+            continue;
+        }
+        data->current_depth = sp->master->current_depth;
+        data->current_root_move = NULL;
+        search_split_point(data, sp);
+        data->assigned_split = NULL;
+        lock_mutex(&sp->lock);
+        sp->num_workers--;
+        unlock_mutex(&sp->lock);
+        data->idle = true;
+    }
+}
+
+static THREAD_FN(helper_thread, arg)
+{
+    search_data_t* data = (search_data_t*)arg;
+    if (options.parallel_algorithm == PARALLEL_YBW) {
+        split_point_idle_loop(data);
+    } else {
+        helper_deepening_search(data);
+    }
+    THREAD_RETURN;
+}
+
+/*
+ * Give helper |i| private pawn, material, and eval tables the same size as
+ * those used by |main_data|. The tables persist between searches, and are only
+ * reallocated if the main tables are resized.
+ */
+static void init_helper_tables(int i, search_data_t* main_data)
+{
+    pawn_table_t* pt = &helper_pawn_tables[i];
+    material_table_t* mt = &helper_material_tables[i];
+    eval_table_t* et = &helper_eval_tables[i];
+    if (pt->num_buckets != main_data->pawn_table->num_buckets) {
+        init_pawn_table(pt,
+                main_data->pawn_table->num_buckets * sizeof(pawn_data_t));
+    }
+    if (mt->num_buckets != main_data->material_table->num_buckets) {
+        init_material_table(mt, main_data->material_table->num_buckets *
+                sizeof(material_data_t));
+    }
+    if (et->num_buckets != main_data->eval_table->num_buckets) {
+        init_eval_table(et,
+                main_data->eval_table->num_buckets * sizeof(eval_entry_t));
+    }
+}
+
+/*
+ * Start options.num_threads-1 helpers searching the same position as
+ * |main_data|. Helpers inherit the root moves and depth limit, but keep
+ * their own history, killers, node counts, and pawn, material, and eval
+ * tables.
+ * The transposition table and pv cache are shared with |main_data|.
+ */
+void start_helper_threads(search_data_t* main_data)
+{
+    assert(!helpers_running);
+    if (!split_lock_initialized) {
+        init_mutex(&split_lock);
+        split_lock_initialized = true;
+    }
+    num_helpers = 0;
+    helpers_running = true;
+    int n = CLAMP(options.num_threads, 1, MAX_SEARCH_THREADS) - 1;
+    for (int i=0; i<n; ++i) {
+        if (!helper_data[i]) {
+            helper_data[i] = (search_data_t*)calloc(1, sizeof(search_data_t));
+            if (!helper_data[i]) break;
+        }
+        search_data_t* data = helper_data[i];
+        copy_position(&data->root_pos, &main_data->root_pos);
+        init_search_data(data);
+        memcpy(data->root_moves, main_data->root_moves,
+                sizeof(main_data->root_moves));
+        data->depth_limit = main_data->depth_limit;
+        data->root_in_gtb = main_data->root_in_gtb;
+        data->trans_table = main_data->trans_table;
+        data->pv_cache = main_data->pv_cache;
+        init_helper_tables(i, main_data);
+        data->pawn_table = &helper_pawn_tables[i];
+        data->material_table = &helper_material_tables[i];
+        data->eval_table = &helper_eval_tables[i];
+        data->thread_id = i+1;
+        data->engine_status = ENGINE_THINKING;
+        start_timer(&data->timer);
+        if (!create_thread(&helper_threads[i], helper_thread, data)) {
+            warn("failed to create search thread");
+            break;
+        }
+        ++num_helpers;
+    }
+}
+
+/*
+ * Abort all running helpers and wait for them to exit. Their search data
+ * is kept around until the next search, so node counts can be reported.
+ */
+void stop_helper_threads(void)
+{
+    if (!helpers_running) return;
+    for (int i=0; i<num_helpers; ++i) {
+        helper_data[i]->engine_status = ENGINE_ABORTED;
+    }
+    for (int i=0; i<num_helpers; ++i) join_thread(helper_threads[i]);
+    helpers_running = false;
+}
+
+/*
+ * Total nodes searched by all helpers in the current or most recent search.
+ */
+uint64_t helper_nodes_searched(void)
+{
+    uint64_t nodes = 0;
+    for (int i=0; i<num_helpers; ++i) nodes += helper_data[i]->nodes_searched;
+    return nodes;
+}
+
+/*
+ * Is any helper waiting for split point work? This is only a hint; the
+ * helpers are actually claimed under a lock by |assign_split_point_helpers|.
+ */
+bool idle_helper_available(void)
+{
+    if (!helpers_running) return false;
+    for (int i=0; i<num_helpers; ++i) {
+        if (helper_data[i]->idle) return true;
+    }
+    return false;
+}
+
+/*
+ * Assign idle helpers to |sp|, up to max_split_helpers. Returns the number
+ * of helpers assigned.
+ */
+int assign_split_point_helpers(split_point_t* sp)
+{
+    search_data_t* workers[MAX_SEARCH_THREADS];
+    int n = 0;
+    lock_mutex(&split_lock);
+    for (int i=0; i<num_helpers && n<max_split_helpers; ++i) {
+        if (!helper_data[i]->idle) continue;
+        helper_data[i]->idle = false;
+        workers[n++] = helper_data[i];
+    }
+    sp->num_workers = n;
+    for (int i=0; i<n; ++i) workers[i]->assigned_split = sp;
+    unlock_mutex(&split_lock);
+    return n;
+}
+
+/*
+ * Is some thread currently searching |move| from the position with the
+ * given hash?
+ */
+bool is_move_being_searched(hashkey_t hash, move_t move)
+{
+    hashkey_t key = searching_key(hash, move);
+    return searching_table[searching_index(key)] == key;
+}
+
+/*
+ * Mark |move| as being searched from the position with the given hash.
+ */
+void start_searching_move(hashkey_t hash, move_t move)
+{
+    hashkey_t key = searching_key(hash, move);
+    searching_table[searching_index(key)] = key;
+}
+
+/*
+ * Clear the mark set by |start_searching_move|, unless another move has
+ * already replaced it.
+ */
+void finish_searching_move(hashkey_t hash, move_t move)
+{
+    hashkey_t key = searching_key(hash, move);
+    if (searching_table[searching_index(key)] == key) {
+        searching_table[searching_index(key)] = 0;
+    }
+}
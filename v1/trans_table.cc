@@ -1,60 +1,77 @@
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "daydreamer.h"
 
-static const int bucket_size = 4;
-static size_t num_buckets;
-static int generation;
-static const int generation_limit = 8;
-static int age_score_table[8];
-static transposition_entry_t* transposition_table = NULL;
+static const int bucket_size = TT_BUCKET_SIZE;
+static const int generation_limit = TT_GENERATION_LIMIT;
+static const size_t draft_sample_buckets = 4096;
 
-static struct {
-    uint64_t misses;
-    uint64_t hits;
-    uint64_t occupied;
-    uint64_t alpha;
-    uint64_t beta;
-    uint64_t exact;
-    uint64_t evictions;
-    uint64_t collisions;
-} hash_stats;
+// The table used by the engine's own search, and shared by default with
+// any other searches.
+transposition_table_t default_trans_table;
+
+#define entry_replace_score(tt, entry) \
+    ((tt)->age_score_table[entry_age(entry)] - (entry)->depth)
+#define entry_is_stale(tt, entry) \
+    (entry_is_empty(entry) || entry_age(entry) != (tt)->generation)
+#define entry_draft(entry) \
+    CLAMP((entry)->depth / TT_DEPTH_SCALE, 0, TT_MAX_DRAFT-1)
 
-// TODO: look into "equidistributed draft" method
-#define entry_replace_score(entry) \
-    (age_score_table[(entry)->age] - (entry)->depth)
+#define set_entry_age(entry, age) \
+    ((entry)->flags = ((entry)->flags & ((1<<TT_FLAG_BITS)-1)) | \
+     ((age) << TT_FLAG_BITS))
 
-static void set_transposition_age(int age);
+#define get_bucket(tt, hash)    (tt_bucket(tt, hash)->slots)
+
+static void set_transposition_age(transposition_table_t* tt, int age);
+static void sample_draft_counts(transposition_table_t* tt);
 
 /*
- * Create a transposition table of the appropriate size.
+ * Create a transposition table using as much of |max_bytes| as will hold
+ * a whole number of buckets. Buckets are aligned to cache line boundaries,
+ * so each probe touches only one line. The table is backed by huge pages
+ * and locked into memory if the options ask for it.
  */
-void init_transposition_table(const size_t max_bytes)
+void init_transposition_table(transposition_table_t* tt,
+        const size_t max_bytes)
 {
     assert(max_bytes >= 1024);
-    size_t size = sizeof(transposition_entry_t) * bucket_size;
-    num_buckets = 1;
-    while (size <= max_bytes >> 1) {
-        size <<= 1;
-        num_buckets <<= 1;
-    }
-    if (transposition_table) free(transposition_table);
-    transposition_table = (transposition_entry_t*)malloc(size);
-    assert(transposition_table);
-    clear_transposition_table();
-    set_transposition_age(0);
+    assert(sizeof(transposition_bucket_t) == CACHE_LINE_BYTES);
+    tt->num_buckets = max_bytes / sizeof(transposition_bucket_t);
+    size_t size = tt->num_buckets * sizeof(transposition_bucket_t);
+    int flags = (options.large_pages ? TABLE_LARGE_PAGES : 0) |
+        (options.lock_hash ? TABLE_LOCK : 0);
+    bool ok = alloc_table_memory(&tt->memory, size, flags);
+    assert(ok);
+    (void)ok;
+    tt->buckets = (transposition_bucket_t*)tt->memory.ptr;
+    tt->replacement = (tt_replacement_t)options.tt_replacement;
+    // Fresh table memory is already zeroed, so there's no need to clear it.
+    memset(tt->draft_counts, 0, sizeof(tt->draft_counts));
+    set_transposition_age(tt, 0);
+}
+
+/*
+ * Release the memory held by |tt|.
+ */
+void destroy_transposition_table(transposition_table_t* tt)
+{
+    free_table_memory(&tt->memory);
+    tt->buckets = NULL;
+    tt->num_buckets = 0;
 }
 
 /*
  * Wipe the entire table.
  */
-void clear_transposition_table(void)
+void clear_transposition_table(transposition_table_t* tt)
 {
-    memset(transposition_table, 0,
-            sizeof(transposition_entry_t)*bucket_size*num_buckets);
-    memset(&hash_stats, 0, sizeof(hash_stats));
+    clear_table_memory(&tt->memory);
+    memset(tt->draft_counts, 0, sizeof(tt->draft_counts));
+    memset(&tt->stats, 0, sizeof(tt->stats));
 }
 
 /*
@@ -62,49 +79,247 @@ void clear_transposition_table(void)
  * evicting results from previous searches without flushing them out
  * entirely.
  */
-static void set_transposition_age(int age)
+static void set_transposition_age(transposition_table_t* tt, int age)
 {
     assert(age >= 0 && age < generation_limit);
-    generation = age;
+    tt->generation = age;
     for (int i=0; i<generation_limit; ++i) {
-        age = generation - i;
+        age = tt->generation - i;
         if (age < 0) age += generation_limit;
-        age_score_table[i] = age * 128;
+        tt->age_score_table[i] = age * 128 * TT_DEPTH_SCALE;
     }
-    memset(&hash_stats, 0, sizeof(hash_stats));
+    memset(&tt->stats, 0, sizeof(tt->stats));
 }
 
 /*
  * Bump the transposition age, indicating that all entries belong to a
  * previous search and should be replaced first.
  */
-void increment_transposition_age(void)
+void increment_transposition_age(transposition_table_t* tt)
+{
+    set_transposition_age(tt, (tt->generation + 1) % generation_limit);
+    sample_draft_counts(tt);
+}
+
+/*
+ * Copy the contents of |slot| into |entry|. Each word is read exactly once,
+ * and the key is recovered from the two words together, so it only matches
+ * the position's key if both words came from the same write.
+ */
+static uint32_t read_slot(const volatile transposition_slot_t* slot,
+        transposition_entry_t* entry)
 {
-    set_transposition_age((generation + 1) % generation_limit);
+    const uint64_t check = slot->check;
+    const uint64_t data = slot->data;
+    entry->move = (move_t)(uint32_t)data;
+    entry->score = (int16_t)(data >> 32);
+    entry->depth = (int16_t)(data >> 48);
+    entry->flags = (uint8_t)check;
+    return (uint32_t)(check >> 32) ^ (uint32_t)data ^
+        (uint32_t)(data >> 32) ^ entry->flags;
 }
 
 /*
- * Get the entry for the given position, if it exists.
+ * Store |entry| for the position with the given key into |slot|.
  */
-transposition_entry_t* get_transposition(position_t* pos)
+static void write_slot(volatile transposition_slot_t* slot,
+        uint32_t key,
+        const transposition_entry_t* entry)
 {
-    transposition_entry_t* entry;
-    entry = &transposition_table[(pos->hash % num_buckets) * bucket_size];
-    for (int i=0; i<bucket_size; ++i, ++entry) {
-        if (!entry->key || entry->key != pos->hash) continue;
-        hash_stats.hits++;
-        entry->age = generation;
+    const uint64_t data = pack_transposition_data(entry->move,
+            entry->score, entry->depth);
+    slot->data = data;
+    slot->check = transposition_check(key, data, entry->flags);
+}
+
+/*
+ * Get the entry for the given position, if it exists. The entry is copied
+ * into |entry|, which is returned on a hit; on a miss we return NULL.
+ */
+transposition_entry_t* get_transposition(transposition_table_t* tt,
+        position_t* pos,
+        transposition_entry_t* entry)
+{
+    transposition_slot_t* slot = get_bucket(tt, pos->hash);
+    const uint32_t key = tt_key(pos->hash);
+    for (int i=0; i<bucket_size; ++i, ++slot) {
+        if (read_slot(slot, entry) != key || entry_is_empty(entry)) continue;
+        tt->stats.hits++;
+        tt->stats.slot_hits[i]++;
+        if (entry_age(entry) != tt->generation) {
+            set_entry_age(entry, tt->generation);
+            write_slot(slot, key, entry);
+        }
         return entry;
     }
-    hash_stats.misses++;
+    tt->stats.misses++;
     return NULL;
 }
 
+/*
+ * Replacement policies. Each one picks the slot in a bucket that a new entry
+ * of the given depth should go into, given copies of the bucket's entries.
+ * A policy may also ask for the entry it displaces to be moved into another
+ * slot by setting |demote_to|.
+ */
+typedef int(*replacement_fn)(transposition_table_t* tt,
+        transposition_entry_t* entries,
+        int depth,
+        int* demote_to);
+
+/*
+ * Replace the entry with the highest replace score, preferring entries from
+ * earlier searches and then shallower entries.
+ */
+static int replace_aged_depth(transposition_table_t* tt,
+        transposition_entry_t* entries,
+        int depth,
+        int* demote_to)
+{
+    (void)depth; (void)demote_to;
+    int best_slot = 0, best_replace_score = INT_MIN;
+    for (int i=0; i<bucket_size; ++i) {
+        int replace_score = entry_replace_score(tt, &entries[i]);
+        if (replace_score > best_replace_score) {
+            best_slot = i;
+            best_replace_score = replace_score;
+        }
+    }
+    return best_slot;
+}
+
+/*
+ * The last slot of each bucket always takes new entries, and the rest only
+ * take entries at least as deep as the entries they replace. A deep entry
+ * pushed out of a depth-preferred slot moves to the always-replace slot,
+ * so it survives until the next store to the bucket. This keeps the deep
+ * entries that are expensive to recompute from being flushed out by
+ * quiescence stores when the table is under pressure.
+ */
+static int replace_two_tier(transposition_table_t* tt,
+        transposition_entry_t* entries,
+        int depth,
+        int* demote_to)
+{
+    const int always_slot = bucket_size - 1;
+    int best_slot = 0, best_replace_score = INT_MIN;
+    for (int i=0; i<always_slot; ++i) {
+        int replace_score = entry_replace_score(tt, &entries[i]);
+        if (replace_score > best_replace_score) {
+            best_slot = i;
+            best_replace_score = replace_score;
+        }
+    }
+    transposition_entry_t* victim = &entries[best_slot];
+    if (entry_is_stale(tt, victim)) return best_slot;
+    if (depth < victim->depth) return always_slot;
+    *demote_to = always_slot;
+    return best_slot;
+}
+
+/*
+ * Equidistributed draft replacement: among entries from the current search,
+ * evict the one whose draft (depth in plies) is most common in the table,
+ * so that no single draft crowds out the others. Shallow drafts are by far
+ * the most common, so in practice this protects deep entries, but it also
+ * stops the table from filling up with nothing but deep entries during long
+ * analysis. Entries from earlier searches are always replaced first.
+ */
+static int replace_equidistributed_draft(transposition_table_t* tt,
+        transposition_entry_t* entries,
+        int depth,
+        int* demote_to)
+{
+    (void)depth; (void)demote_to;
+    int best_slot = -1, best_replace_score = INT_MIN;
+    for (int i=0; i<bucket_size; ++i) {
+        if (!entry_is_stale(tt, &entries[i])) continue;
+        int replace_score = entry_replace_score(tt, &entries[i]);
+        if (replace_score > best_replace_score) {
+            best_slot = i;
+            best_replace_score = replace_score;
+        }
+    }
+    if (best_slot >= 0) return best_slot;
+    int64_t best_count = INT64_MIN;
+    for (int i=0; i<bucket_size; ++i) {
+        int64_t count = tt->draft_counts[entry_draft(&entries[i])];
+        if (count > best_count || (count == best_count &&
+                    entries[i].depth < entries[best_slot].depth)) {
+            best_slot = i;
+            best_count = count;
+        }
+    }
+    return best_slot;
+}
+
+static const struct {
+    const char* name;
+    replacement_fn replace;
+} replacement_policies[TT_NUM_REPLACEMENT_POLICIES] = {
+    { "aged depth", replace_aged_depth },
+    { "two tier", replace_two_tier },
+    { "equidistributed draft", replace_equidistributed_draft },
+};
+
+/*
+ * Look up a replacement policy by name. Returns -1 if there's no such
+ * policy.
+ */
+int replacement_policy_index(const char* name)
+{
+    for (int i=0; i<TT_NUM_REPLACEMENT_POLICIES; ++i) {
+        if (!strcasecmp(name, replacement_policies[i].name)) return i;
+    }
+    return -1;
+}
+
+/*
+ * Update the draft distribution to account for |entry| entering (|delta|
+ * is 1) or leaving (|delta| is -1) the table. Search threads share the
+ * counts and update them without locking, so some updates are lost and the
+ * counts drift; |sample_draft_counts| resyncs them before each search.
+ */
+static void count_draft(transposition_table_t* tt,
+        transposition_entry_t* entry,
+        int delta)
+{
+    if (entry_is_empty(entry)) return;
+    tt->draft_counts[entry_draft(entry)] += delta;
+}
+
+/*
+ * Estimate the draft distribution of the whole table from a fixed number of
+ * buckets spread evenly through it. Only the sampled buckets are read, so a
+ * table mapped from a file isn't paged in all at once.
+ */
+static void sample_draft_counts(transposition_table_t* tt)
+{
+    memset(tt->draft_counts, 0, sizeof(tt->draft_counts));
+    const size_t samples = MIN(tt->num_buckets, draft_sample_buckets);
+    if (!samples) return;
+    for (size_t i=0; i<samples; ++i) {
+        transposition_slot_t* slot =
+            tt->buckets[i * tt->num_buckets / samples].slots;
+        for (int j=0; j<bucket_size; ++j) {
+            transposition_entry_t entry;
+            read_slot(&slot[j], &entry);
+            count_draft(tt, &entry, 1);
+        }
+    }
+    for (int i=0; i<TT_MAX_DRAFT; ++i) {
+        tt->draft_counts[i] = tt->draft_counts[i] *
+            (int64_t)tt->num_buckets / (int64_t)samples;
+    }
+}
+
 /*
  * Place a position into the table, giving the score, depth searched,
- * and recommended move.
+ * and recommended move. The slot used for a new position is chosen by the
+ * table's replacement policy.
  */
-void put_transposition(position_t* pos,
+void put_transposition(transposition_table_t* tt,
+        position_t* pos,
         move_t move,
         float depth,
         int score,
@@ -112,51 +327,61 @@ void put_transposition(position_t* pos,
         bool mate_threat)
 {
     if (depth < 0) depth = 0;
-    transposition_entry_t* entry, *best_entry = NULL;
-    int replace_score, best_replace_score = INT_MIN;
-    entry = &transposition_table[(pos->hash % num_buckets) * bucket_size];
-    for (int i=0; i<bucket_size; ++i, ++entry) {
-        if (entry->key == pos->hash) {
+    transposition_slot_t* slots = get_bucket(tt, pos->hash);
+    transposition_entry_t entries[TT_BUCKET_SIZE];
+    uint32_t keys[TT_BUCKET_SIZE];
+    const uint32_t key = tt_key(pos->hash);
+    const int16_t tt_depth = (int16_t)(depth * TT_DEPTH_SCALE);
+    int slot = -1, demote_to = -1, slot_removed = -1;
+    for (int i=0; i<bucket_size; ++i) {
+        keys[i] = read_slot(&slots[i], &entries[i]);
+        if (keys[i] == key && !entry_is_empty(&entries[i])) {
             // Update an existing entry
-            entry->age = generation;
-            entry->depth = depth;
-            entry->move = move;
-            entry->score = score;
-            entry->flags = score_type | mate_threat;
-            switch (score_type) {
-                case SCORE_LOWERBOUND: hash_stats.beta++; break;
-                case SCORE_UPPERBOUND: hash_stats.alpha++; break;
-                case SCORE_EXACT: hash_stats.exact++;
-            }
-            switch (entry->flags & SCORE_MASK) {
-                case SCORE_LOWERBOUND: hash_stats.beta--; break;
-                case SCORE_UPPERBOUND: hash_stats.alpha--; break;
-                case SCORE_EXACT: hash_stats.exact--;
+            switch (entries[i].flags & SCORE_MASK) {
+                case SCORE_LOWERBOUND: tt->stats.beta--; break;
+                case SCORE_UPPERBOUND: tt->stats.alpha--; break;
+                case SCORE_EXACT: tt->stats.exact--;
             }
-            return;
+            slot = i;
+            break;
         }
-        replace_score = entry_replace_score(entry);
-        if (replace_score > best_replace_score) {
-            best_entry = entry;
-            best_replace_score = replace_score;
+    }
+    if (slot < 0) {
+        slot = replacement_policies[tt->replacement].replace(tt,
+                entries, tt_depth, &demote_to);
+        slot_removed = slot;
+        assert(slot >= 0 && slot < bucket_size);
+        if (demote_to >= 0) {
+            // The entry in |slot| moves to |demote_to|, and the entry in
+            // |demote_to| is the one that leaves the table.
+            tt->stats.demotions++;
+            write_slot(&slots[demote_to], keys[slot], &entries[slot]);
+            entries[slot] = entries[demote_to];
+            slot_removed = demote_to;
+        }
+        transposition_entry_t* victim = &entries[slot];
+        if (entry_is_stale(tt, victim)) tt->stats.occupied++;
+        else {
+            ++tt->stats.evictions;
+            tt->stats.slot_evictions[slot_removed]++;
+            tt->stats.evicted_depth += victim->depth;
         }
     }
-    // Replace the entry with the highest replace score.
-    assert(best_entry != NULL);
-    entry = best_entry;
-    if (!entry->key || entry->age != generation) hash_stats.occupied++;
-    else ++hash_stats.evictions;
+    count_draft(tt, &entries[slot], -1);
     switch (score_type) {
-        case SCORE_LOWERBOUND: hash_stats.beta++; break;
-        case SCORE_UPPERBOUND: hash_stats.alpha++; break;
-        case SCORE_EXACT: hash_stats.exact++;
+        case SCORE_LOWERBOUND: tt->stats.beta++; break;
+        case SCORE_UPPERBOUND: tt->stats.alpha++; break;
+        case SCORE_EXACT: tt->stats.exact++;
     }
-    entry->age = generation;
-    entry->key = pos->hash;
+    tt->stats.slot_stores[slot]++;
+    transposition_entry_t* entry = &entries[slot];
     entry->move = move;
-    entry->depth = depth;
     entry->score = score;
-    entry->flags = score_type | mate_threat;
+    entry->depth = tt_depth;
+    entry->flags = (score_type | mate_threat) |
+        (tt->generation << TT_FLAG_BITS);
+    count_draft(tt, entry, 1);
+    write_slot(&slots[slot], key, entry);
 }
 
 /*
@@ -164,45 +389,214 @@ void put_transposition(position_t* pos,
  * the pv at the end of each iteration of ID search, in case any of the moves
  * were evicted.
  */
-void put_transposition_line(position_t* pos,
+void put_transposition_line(transposition_table_t* tt,
+        position_t* pos,
         move_t* moves,
         float depth,
         int score,
         score_type_t score_type)
 {
     if (!*moves) return;
-    put_transposition(pos, *moves, depth, score, score_type, false);
+    put_transposition(tt, pos, *moves, depth, score, score_type, false);
     undo_info_t undo;
     do_move(pos, *moves, &undo);
     int x = is_mate_score(score) ? (score > 0 ? 1 : -1) : 0;
-    put_transposition_line(pos, moves+1, depth-1, score+x, score_type);
+    put_transposition_line(tt, pos, moves+1, depth-1, score+x, score_type);
     undo_move(pos, *moves, &undo);
 }
 
+/*
+ * Saved tables start with this header, padded out to TT_FILE_HEADER_BYTES
+ * so that the buckets that follow are page aligned and the file can be
+ * mapped directly as table memory. Buckets are written in native byte
+ * order; |byte_order| catches files written on a machine of the other
+ * endianness.
+ */
+#define TT_FILE_MAGIC           "DDTTABLE"
+#define TT_FILE_VERSION         1
+#define TT_FILE_BYTE_ORDER      0x01020304
+#define TT_FILE_HEADER_BYTES    65536
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t bucket_bytes;
+    uint32_t bucket_size;
+    uint32_t depth_scale;
+    uint32_t generation;
+    uint64_t num_buckets;
+    uint64_t occupied;
+    hashkey_t signature;
+} tt_file_header_t;
+
+/*
+ * Write the contents of |tt| to |filename|. The table is written to a
+ * temporary file which then replaces |filename|, so a failed save doesn't
+ * destroy an earlier one, and saving over the file |tt| was loaded from
+ * doesn't pull the mapped pages out from under it. Returns false if the
+ * file couldn't be written.
+ */
+bool save_transposition_table(transposition_table_t* tt, const char* filename)
+{
+    char temp_filename[FILENAME_MAX];
+    snprintf(temp_filename, FILENAME_MAX, "%s.tmp", filename);
+    FILE* file = fopen(temp_filename, "wb");
+    if (!file) {
+        printf("info string couldn't open %s for writing: %s\n",
+                temp_filename, strerror(errno));
+        return false;
+    }
+    char header_bytes[TT_FILE_HEADER_BYTES];
+    memset(header_bytes, 0, TT_FILE_HEADER_BYTES);
+    tt_file_header_t* header = (tt_file_header_t*)header_bytes;
+    memcpy(header->magic, TT_FILE_MAGIC, sizeof(header->magic));
+    header->version = TT_FILE_VERSION;
+    header->byte_order = TT_FILE_BYTE_ORDER;
+    header->bucket_bytes = sizeof(transposition_bucket_t);
+    header->bucket_size = TT_BUCKET_SIZE;
+    header->depth_scale = TT_DEPTH_SCALE;
+    header->generation = tt->generation;
+    header->num_buckets = tt->num_buckets;
+    header->occupied = tt->stats.occupied;
+    header->signature = hash_signature();
+    bool ok = fwrite(header_bytes, TT_FILE_HEADER_BYTES, 1, file) == 1 &&
+        fwrite(tt->buckets, sizeof(transposition_bucket_t),
+                tt->num_buckets, file) == tt->num_buckets;
+    if (fclose(file) || !ok) {
+        printf("info string error writing %s: %s\n",
+                temp_filename, strerror(errno));
+        remove(temp_filename);
+        return false;
+    }
+#ifdef _WIN32
+    // Windows won't rename over an existing file, so the old save has to go
+    // first. Elsewhere rename replaces it in one step, and the old save
+    // survives until the new one is in place.
+    remove(filename);
+#endif
+    if (rename(temp_filename, filename)) {
+        printf("info string couldn't rename %s to %s: %s\n",
+                temp_filename, filename, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Replace the contents of |tt| with a table saved by
+ * |save_transposition_table|. The table takes on the size of the saved
+ * table. The file is mapped rather than read, so loading is fast even for
+ * very large tables. If the file can't be used, |tt| is left unchanged and
+ * we return false.
+ */
+bool load_transposition_table(transposition_table_t* tt, const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        printf("info string couldn't open %s: %s\n",
+                filename, strerror(errno));
+        return false;
+    }
+    tt_file_header_t header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1;
+    uint64_t file_bytes = 0;
+    if (!fseeko(file, 0, SEEK_END)) file_bytes = ftello(file);
+    fclose(file);
+    if (!ok || memcmp(header.magic, TT_FILE_MAGIC, sizeof(header.magic))) {
+        printf("info string %s is not a saved hash table\n", filename);
+        return false;
+    }
+    if (header.version != TT_FILE_VERSION ||
+            header.byte_order != TT_FILE_BYTE_ORDER ||
+            header.bucket_bytes != sizeof(transposition_bucket_t) ||
+            header.bucket_size != TT_BUCKET_SIZE ||
+            header.depth_scale != TT_DEPTH_SCALE ||
+            header.generation >= TT_GENERATION_LIMIT ||
+            !header.num_buckets) {
+        printf("info string %s uses an incompatible hash table format\n",
+                filename);
+        return false;
+    }
+    if (file_bytes < TT_FILE_HEADER_BYTES +
+            header.num_buckets * sizeof(transposition_bucket_t)) {
+        printf("info string %s is truncated\n", filename);
+        return false;
+    }
+    if (header.signature != hash_signature()) {
+        printf("info string %s was saved with different hash keys\n",
+                filename);
+        return false;
+    }
+    table_memory_t memory;
+    memset(&memory, 0, sizeof(memory));
+    if (!map_table_file(&memory, filename, TT_FILE_HEADER_BYTES,
+                header.num_buckets * sizeof(transposition_bucket_t))) {
+        printf("info string couldn't map %s\n", filename);
+        return false;
+    }
+    free_table_memory(&tt->memory);
+    tt->memory = memory;
+    tt->buckets = (transposition_bucket_t*)tt->memory.ptr;
+    tt->num_buckets = header.num_buckets;
+    set_transposition_age(tt, header.generation);
+    sample_draft_counts(tt);
+    tt->stats.occupied = header.occupied;
+    return true;
+}
+
 /*
  * Print some stats about the transposition table.
  */
-void print_transposition_stats(void)
+void print_transposition_stats(transposition_table_t* tt)
+{
+    uint64_t num_entries = (uint64_t)tt->num_buckets * bucket_size;
+    printf("info string hash entries %"PRIu64, num_entries);
+    printf(" filled %"PRIu64" (%.2f%%)", tt->stats.occupied,
+            (float)tt->stats.occupied / (float)num_entries * 100.);
+    printf(" evictions %"PRIu64, tt->stats.evictions);
+    printf(" hits %"PRIu64" (%.2f%%)", tt->stats.hits,
+            (float)tt->stats.hits / (tt->stats.hits+tt->stats.misses)*100.);
+    printf(" misses %"PRIu64" (%.2f%%)", tt->stats.misses,
+            (float)tt->stats.misses/(tt->stats.hits+tt->stats.misses)*100.);
+    printf(" alpha %"PRIu64"", tt->stats.alpha);
+    printf(" beta %"PRIu64"", tt->stats.beta);
+    printf(" exact %"PRIu64"\n", tt->stats.exact);
+
+    // Break hits, stores, and evictions down by slot, so replacement
+    // policies can be compared.
+    printf("info string hash replacement %s",
+            replacement_policies[tt->replacement].name);
+    const char* labels[3] = { "hits", "stores", "evictions" };
+    const uint64_t* counts[3] = {
+        tt->stats.slot_hits, tt->stats.slot_stores, tt->stats.slot_evictions
+    };
+    for (int i=0; i<3; ++i) {
+        printf(" %s", labels[i]);
+        for (int j=0; j<bucket_size; ++j) {
+            printf("%c%"PRIu64, j ? '/' : ' ', counts[i][j]);
+        }
+    }
+    printf(" demotions %"PRIu64, tt->stats.demotions);
+    printf(" mean evicted depth %.2f\n", tt->stats.evictions ?
+            (float)tt->stats.evicted_depth / TT_DEPTH_SCALE /
+            tt->stats.evictions : 0.);
+}
+
+/*
+ * The number of bytes of entries allocated for |tt|.
+ */
+size_t transposition_table_bytes(const transposition_table_t* tt)
 {
-    int num_entries = num_buckets * bucket_size;
-    printf("info string hash entries %d", num_entries);
-    printf(" filled %"PRIu64" (%.2f%%)", hash_stats.occupied,
-            (float)hash_stats.occupied / (float)num_entries * 100.);
-    printf(" evictions %"PRIu64, hash_stats.evictions);
-    printf(" hits %"PRIu64" (%.2f%%)", hash_stats.hits,
-            (float)hash_stats.hits / (hash_stats.hits+hash_stats.misses)*100.);
-    printf(" misses %"PRIu64" (%.2f%%)", hash_stats.misses,
-            (float)hash_stats.misses/(hash_stats.hits+hash_stats.misses)*100.);
-    printf(" alpha %"PRIu64"", hash_stats.alpha);
-    printf(" beta %"PRIu64"", hash_stats.beta);
-    printf(" exact %"PRIu64"\n", hash_stats.exact);
+    return tt->num_buckets * sizeof(transposition_bucket_t);
 }
 
 /*
  * How full is the hash table, in thousandths? Used for UCI info strings.
  */
-int get_hashfull(void)
+int get_hashfull(transposition_table_t* tt)
 {
-    return MIN(1000 * hash_stats.occupied / (num_buckets * bucket_size), 1000);
+    return MIN(1000 * tt->stats.occupied /
+            (tt->num_buckets * bucket_size), 1000);
 }
 
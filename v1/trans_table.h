@@ -5,17 +5,92 @@
 extern "C" {
 #endif
 
-// TODO: shrink this structure.
-// TODO: track mate threats and whether null moves should be attempted
+// A copy of the information stored for a position, as returned by a probe.
+// Depth is a fixed point number of TT_DEPTH_SCALE units per ply. The low
+// three bits of |flags| hold the score type and mate threat flag, and the
+// remaining bits hold the entry's age.
+// TODO: track whether null moves should be attempted
 typedef struct {
-    hashkey_t key;
     move_t move;
-    float depth;
     int16_t score;
-    uint8_t age;
+    int16_t depth;
     uint8_t flags;
 } transposition_entry_t;
 
+// Entries are stored packed into two 64-bit words, so that a bucket of four
+// fills one cache line. |data| holds the move, score, and depth. The low
+// bits of |check| hold the flags, and the high 32 bits hold the lower half
+// of the hash xored with everything else in the entry. The upper bits of
+// the hash select the bucket. Threads read and write slots without locks,
+// so a slot may be torn by a concurrent write; a torn slot fails the check
+// and is treated as a miss.
+typedef struct {
+    uint64_t check;
+    uint64_t data;
+} transposition_slot_t;
+
+#define TT_BUCKET_SIZE      4
+#define TT_DEPTH_SCALE      8
+#define TT_GENERATION_LIMIT 8
+#define TT_FLAG_BITS        3
+#define TT_MAX_DRAFT        64
+
+// Policies for choosing which entry in a bucket a new position replaces.
+typedef enum {
+    TT_REPLACE_AGED_DEPTH,
+    TT_REPLACE_TWO_TIER,
+    TT_REPLACE_EQUIDISTRIBUTED_DRAFT,
+    TT_NUM_REPLACEMENT_POLICIES
+} tt_replacement_t;
+
+typedef struct {
+    transposition_slot_t slots[TT_BUCKET_SIZE];
+} CACHE_ALIGN transposition_bucket_t;
+
+#define tt_bucket(tt, hash) \
+    (&(tt)->buckets[hash_index(hash, (tt)->num_buckets)])
+#define prefetch_transposition(tt, hash)    \
+    prefetch_address(tt_bucket(tt, hash))
+#define tt_key(hash)            ((uint32_t)(hash))
+#define entry_depth(entry)      ((float)(entry)->depth / TT_DEPTH_SCALE)
+#define entry_age(entry)        ((entry)->flags >> TT_FLAG_BITS)
+#define entry_is_empty(entry)   (((entry)->flags & SCORE_MASK) == 0)
+
+#define pack_transposition_data(move, score, depth) \
+    ((uint64_t)(uint32_t)(move) | \
+     ((uint64_t)(uint16_t)(score) << 32) | \
+     ((uint64_t)(uint16_t)(depth) << 48))
+#define transposition_check(key, data, flags) \
+    (((uint64_t)((key) ^ (uint32_t)(data) ^ (uint32_t)((data) >> 32) ^ \
+                 (flags)) << 32) | (flags))
+
+typedef struct {
+    transposition_bucket_t* buckets;
+    table_memory_t memory;
+    size_t num_buckets;
+    int generation;
+    int age_score_table[TT_GENERATION_LIMIT];
+    tt_replacement_t replacement;
+    int64_t draft_counts[TT_MAX_DRAFT];
+    struct {
+        uint64_t misses;
+        uint64_t hits;
+        uint64_t occupied;
+        uint64_t alpha;
+        uint64_t beta;
+        uint64_t exact;
+        uint64_t evictions;
+        uint64_t collisions;
+        uint64_t demotions;
+        uint64_t evicted_depth;
+        uint64_t slot_hits[TT_BUCKET_SIZE];
+        uint64_t slot_stores[TT_BUCKET_SIZE];
+        uint64_t slot_evictions[TT_BUCKET_SIZE];
+    } stats;
+} transposition_table_t;
+
+extern transposition_table_t default_trans_table;
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -34,6 +34,14 @@ static void uci_print_help(void)
 "    perft <n>  \tPrint the number of positions that could be reached from the "
 "               \tcurrent position in exactly <n> moves.\n"
 "    divide <n> \tThe same as perft, but break numbers down by root move.\n"
+"    perft hash <mb>\n"
+"               \tCache perft results in a table of the given size. A size\n"
+"               \tof 0 disables the table.\n"
+"    hash save <file>\n"
+"               \tSave the contents of the hash table to a file.\n"
+"    hash load <file>\n"
+"               \tReplace the hash table with one saved by hash save. The\n"
+"               \ttable takes the size of the saved table.\n"
 "    see <move> \tPrint the static exchange evaluation score of the given "
 "move.\n"
 "    bench <depth>\n"
@@ -42,9 +50,10 @@ static void uci_print_help(void)
 "    perftsuite <filename>\n"
 "               \tRun a suite of perft tests from a file in the format\n"
 "               \tdescribed at www.rocechess.ch/rocee.html\n"
-"   epd <filename> <time>\n"
+"   epd <filename> <time> [threads <n>]\n"
 "              \tRead the given epd file, and search each position for <time>\n"
-"               \tseconds.\n"
+"               \tseconds. With <n> threads, positions are searched in\n"
+"               \tparallel by <n> independent searches.\n"
 "   book        \tPrint book information for the current position.\n"
 "               \tUses the currently loaded book.\n"
 "   <move>      \tMake the given move (eg e2e4) on the internal board.\n"
@@ -123,6 +132,10 @@ static void uci_handle_ext(char* command)
         command+=10;
         while (isspace(*command)) command++;
         perft_testsuite(command);
+    } else if (!strncasecmp(command, "perft hash", 10)) {
+        int mbytes = 0;
+        sscanf(command+10, " %d", &mbytes);
+        init_perft_table(mbytes * (1ull<<20));
     } else if (!strncasecmp(command, "perft", 5)) {
         int depth=1;
         sscanf(command+5, " %d", &depth);
@@ -131,6 +144,21 @@ static void uci_handle_ext(char* command)
         int depth=1;
         sscanf(command+6, " %d", &depth);
         perft(pos, depth, true);
+    } else if (!strncasecmp(command, "hash save", 9)) {
+        command += 9;
+        while (isspace(*command)) command++;
+        if (save_transposition_table(&default_trans_table, command)) {
+            printf("info string saved hash to %s\n", command);
+        }
+    } else if (!strncasecmp(command, "hash load", 9)) {
+        command += 9;
+        while (isspace(*command)) command++;
+        if (load_transposition_table(&default_trans_table, command)) {
+            printf("info string loaded hash from %s, %d MB, %d%% full\n",
+                    command,
+                    (int)(transposition_table_bytes(&default_trans_table)>>20),
+                    get_hashfull(&default_trans_table) / 10);
+        }
     } else if (!strncasecmp(command, "bench", 5)) {
         int depth = 1;
         sscanf(command+5, " %d", &depth);
@@ -143,9 +171,12 @@ static void uci_handle_ext(char* command)
     } else if (!strncasecmp(command, "epd", 3)) {
         char filename[256];
         int time_per_move = 5;
+        int num_threads = 1;
         sscanf(command+3, " %s %d", filename, &time_per_move);
+        char* threads = strcasestr(command+3, "threads");
+        if (threads) sscanf(threads+7, " %d", &num_threads);
         time_per_move *= 1000;
-        epd_testsuite(filename, time_per_move);
+        epd_testsuite(filename, time_per_move, num_threads);
     } else if (!strncasecmp(command, "gtb", 3)) {
         if (options.use_gtb) {
             int score;
@@ -182,7 +213,8 @@ static void uci_handle_ext(char* command)
         }
         printf("\nordered moves: ");
         move_selector_t sel;
-        init_move_selector(&sel, pos, PV_GEN, NULL, NO_MOVE, 0, 0);
+        init_move_selector(&sel, &root_data, pos, PV_GEN,
+                NULL, NO_MOVE, 0, 0);
         for (move_t move = select_move(&sel); move != NO_MOVE;
                 move = select_move(&sel)) {
             char san[8];
@@ -191,8 +223,9 @@ static void uci_handle_ext(char* command)
         }
         printf("\n");
         eval_data_t ed;
+        init_eval_data(&ed, &default_pawn_table, &default_material_table, NULL);
         int eval = full_eval(pos, &ed);
-        _check_eval_symmetry(pos, eval);
+        _check_eval_symmetry(pos, &ed, eval);
     } else if (!strncasecmp(command, "help", 4) ||
             !strncasecmp(command, "?", 1)) {
         uci_print_help();
@@ -262,7 +295,8 @@ static void uci_go(char* command)
             if (!is_move_legal(&root_data.root_pos, move)) {
                 printf("%s is not a legal move\n", info);
             }
-            init_root_move(&root_data.root_moves[move_index++], move);
+            init_root_move(&root_data,
+                    &root_data.root_moves[move_index++], move);
             while (*info && !isspace(*info)) ++info;
             while (isspace(*info)) ++info;
         }
@@ -182,6 +182,51 @@ static void handle_verbosity(void* opt, const char* value)
     else if (!strcasecmp(value, "high")) options.verbosity = 2;
 }
 
+/*
+ * Select the algorithm used to split work between search threads.
+ */
+static void handle_parallel_algorithm(void* opt, const char* value)
+{
+    if (!value) return;
+    uci_option_t* option = (uci_option_t*)opt;
+    strncpy(option->value, value, 128);
+    options.parallel_algorithm = PARALLEL_LAZY_SMP;
+    if (!strcasecmp(value, "ybw")) options.parallel_algorithm = PARALLEL_YBW;
+    else if (!strcasecmp(value, "abdada")) {
+        options.parallel_algorithm = PARALLEL_ABDADA;
+    }
+}
+
+/*
+ * Tell the interface how much memory the transposition table got, how many
+ * entries that holds, and what kind of pages back it.
+ */
+static void report_hash_memory(void)
+{
+    printf("info string hash %d MB, %"PRIu64" entries, %s\n",
+            (int)(transposition_table_bytes(&default_trans_table) >> 20),
+            (uint64_t)default_trans_table.num_buckets * TT_BUCKET_SIZE,
+            table_memory_description(&default_trans_table.memory));
+}
+
+/*
+ * Select the transposition table replacement policy. Takes effect
+ * immediately, without clearing the table.
+ */
+static void handle_hash_replacement(void* opt, const char* value)
+{
+    if (!value) return;
+    uci_option_t* option = (uci_option_t*)opt;
+    int policy = replacement_policy_index(value);
+    if (policy < 0) {
+        warn("Unknown replacement policy, using default\n");
+        policy = replacement_policy_index(option->default_value);
+    }
+    strncpy(option->value, value, 128);
+    options.tt_replacement = policy;
+    default_trans_table.replacement = (tt_replacement_t)policy;
+}
+
 /*
  * Initialize the transposition table.
  */
@@ -195,7 +240,22 @@ static void handle_hash(void* opt, const char* value)
         warn("Option value out of range, using default\n");
         sscanf(option->default_value, "%d", &mbytes);
     }
-    init_transposition_table(mbytes * (1ull<<20));
+    init_transposition_table(&default_trans_table, mbytes * (1ull<<20));
+    report_hash_memory();
+}
+
+/*
+ * Change how hash table memory is allocated. The transposition table is
+ * reallocated immediately if it already exists; the smaller tables pick up
+ * the change the next time they're resized.
+ */
+static void handle_table_memory(void* opt, const char* value)
+{
+    default_handler(opt, value);
+    if (!default_trans_table.num_buckets) return;
+    init_transposition_table(&default_trans_table,
+            transposition_table_bytes(&default_trans_table));
+    report_hash_memory();
 }
 
 /*
@@ -211,7 +271,27 @@ static void handle_pawn_cache(void* opt, const char* value)
         warn("Option value out of range, using default\n");
         sscanf(option->default_value, "%d", &mbytes);
     }
-    init_pawn_table(mbytes * (1ull<<20));
+    init_pawn_table(&default_pawn_table, mbytes * (1ull<<20));
+    printf("info string pawn cache %d entries\n",
+            default_pawn_table.num_buckets);
+}
+
+/*
+ * Initialize the eval cache.
+ */
+static void handle_eval_cache(void* opt, const char* value)
+{
+    uci_option_t* option = (uci_option_t*)opt;
+    int mbytes = 0;
+    strncpy(option->value, value, 128);
+    sscanf(value, "%d", &mbytes);
+    if (mbytes < option->min || mbytes > option->max) {
+        warn("Option value out of range, using default\n");
+        sscanf(option->default_value, "%d", &mbytes);
+    }
+    init_eval_table(&default_eval_table, mbytes * (1ull<<20));
+    printf("info string eval cache %d entries\n",
+            default_eval_table.num_buckets);
 }
 
 /*
@@ -227,7 +307,8 @@ static void handle_pv_cache(void* opt, const char* value)
         warn("Option value out of range, using default\n");
         sscanf(option->default_value, "%d", &mbytes);
     }
-    init_pv_cache(mbytes * (1ull<<20));
+    init_pv_cache(&default_pv_cache, mbytes * (1ull<<20));
+    printf("info string pv cache %d entries\n", default_pv_cache.num_buckets);
 }
 
 /*
@@ -236,7 +317,7 @@ static void handle_pv_cache(void* opt, const char* value)
 static void handle_clear_hash(void* opt, const char* value)
 {
     (void) opt; (void) value;
-    clear_transposition_table();
+    clear_transposition_table(&default_trans_table);
 }
 
 /*
@@ -368,6 +449,18 @@ static void handle_book_file(void* opt, const char* value)
  */
 void init_uci_options()
 {
+    add_uci_option("Use large pages", OPTION_CHECK, "true",
+            0, 0, NULL, &options.large_pages, &handle_table_memory);
+    add_uci_option("Lock hash in memory", OPTION_CHECK, "false",
+            0, 0, NULL, &options.lock_hash, &handle_table_memory);
+    // Options whose names start with "Hash" have to come before it, because
+    // options are matched by prefix.
+    const char* policies[4] = {
+        "aged depth", "two tier", "equidistributed draft", NULL
+    };
+    add_uci_option("Hash replacement", OPTION_COMBO, "aged depth",
+            0, 0, (char**)policies, &options.tt_replacement,
+            &handle_hash_replacement);
     add_uci_option("Hash", OPTION_SPIN, "64",
             1, 4096, NULL, NULL, &handle_hash);
     add_uci_option("Clear Hash", OPTION_BUTTON, "",
@@ -376,6 +469,13 @@ void init_uci_options()
             0, 0, NULL, &options.ponder, &default_handler);
     add_uci_option("MultiPV", OPTION_SPIN, "1",
             1, 256, NULL, &options.multi_pv, &default_handler);
+    add_uci_option("Threads", OPTION_SPIN, "1",
+            1, MAX_SEARCH_THREADS, NULL, &options.num_threads,
+            &default_handler);
+    const char* algorithms[4] = { "lazy smp", "ybw", "abdada", NULL };
+    add_uci_option("Parallel algorithm", OPTION_COMBO, "lazy smp",
+            0, 0, (char**)algorithms, &options.parallel_algorithm,
+            &handle_parallel_algorithm);
     add_uci_option("OwnBook", OPTION_CHECK, "false",
             0, 0, NULL, &options.use_book, &default_handler);
     add_uci_option("Book file", OPTION_STRING, "book.bin",
@@ -384,6 +484,10 @@ void init_uci_options()
             0, 0, NULL, &options.chess960, &default_handler);
     add_uci_option("Arena-style 960 castling", OPTION_CHECK, "false",
             0, 0, NULL, &options.arena_castle, &default_handler);
+    add_uci_option("Bitboard move generation", OPTION_CHECK, "true",
+            0, 0, NULL, &options.bitboard_movegen, &default_handler);
+    add_uci_option("Pin-aware SEE", OPTION_CHECK, "false",
+            0, 0, NULL, &options.pin_aware_see, &default_handler);
     add_uci_option("Use Gaviota tablebases", OPTION_CHECK, "false",
             0, 0, NULL, &options.use_gtb, &handle_gtb_use);
     add_uci_option("Gaviota tablebase path", OPTION_STRING, ".",
@@ -403,6 +507,8 @@ void init_uci_options()
             0, 0, NULL, NULL, &handle_scorpio_bb_path);
     add_uci_option("Pawn cache size", OPTION_SPIN, "1",
             1, 128, NULL, NULL, &handle_pawn_cache);
+    add_uci_option("Eval cache size", OPTION_SPIN, "4",
+            1, 1024, NULL, NULL, &handle_eval_cache);
     add_uci_option("PV cache size", OPTION_SPIN, "32",
             1, 1024, NULL, NULL, &handle_pv_cache);
     add_uci_option("Output Delay", OPTION_SPIN, "2000",